@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * dtbloader-chid - Check chid.c against fwupd and measure it.
+ *
+ * For every "fwupdtool hwids" dump given (i.e. ones in scripts/hwids) this
+ * builds a synthetic SMBIOS table, runs populate_board_hwids() on it and
+ * compares every CHID that fwupd could compute with ours.
+ *
+ * The batched (multi-buffer) CHIDs are also checked against the serial
+ * reference implementation and both are timed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "chid.h"
+#include "smbios.h"
+#include "firmware.h"
+#include "hwids.h"
+
+static void print_guid(const EFI_GUID *g)
+{
+	printf("%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+	       g->Data1, g->Data2, g->Data3, g->Data4[0], g->Data4[1],
+	       g->Data4[2], g->Data4[3], g->Data4[4], g->Data4[5],
+	       g->Data4[6], g->Data4[7]);
+}
+
+static int check_file(const char *path, unsigned long iterations)
+{
+	EFI_GUID hwids[HWIDS_CHID_COUNT] = {0}, serial[HWIDS_CHID_COUNT] = {0};
+	unsigned long allocs, i;
+	struct hwids hw;
+	EFI_STATUS status;
+	UINT64 start, ns, serial_ns;
+	int fails = 0;
+
+	if (hwids_parse(path, &hw)) {
+		fprintf(stderr, "%s: failed to parse\n", path);
+		return 1;
+	}
+
+	hwids_install_smbios(&hw);
+
+	allocs = host_stats.pool_allocs;
+	status = populate_board_hwids(hwids);
+	allocs = host_stats.pool_allocs - allocs;
+	if (EFI_ERROR(status)) {
+		fprintf(stderr, "%s: populate_board_hwids() failed: %lx\n", path, (unsigned long)status);
+		hwids_free(&hw);
+		return 1;
+	}
+
+	populate_board_hwids_serial(serial);
+
+	for (i = 0; i < HWIDS_CHID_COUNT; ++i) {
+		if (CompareGuid(&hwids[i], &serial[i])) {
+			printf("%s: CHID %lu differs from serial: ", path, i);
+			print_guid(&hwids[i]);
+			printf(" != ");
+			print_guid(&serial[i]);
+			printf("\n");
+			fails++;
+		}
+
+		if (!hw.has_chid[i] || !CompareGuid(&hwids[i], &hw.chids[i]))
+			continue;
+
+		printf("%s: CHID %lu mismatch: ", path, i);
+		print_guid(&hwids[i]);
+		printf(" != ");
+		print_guid(&hw.chids[i]);
+		printf("\n");
+		fails++;
+	}
+
+	/* Time a cold SMBIOS walk each time, like on boot. */
+	start = host_time_ns();
+	for (i = 0; i < iterations; ++i) {
+		smbios_reset();
+		populate_board_hwids(hwids);
+	}
+	ns = (host_time_ns() - start) / iterations;
+
+	start = host_time_ns();
+	for (i = 0; i < iterations; ++i) {
+		smbios_reset();
+		populate_board_hwids_serial(serial);
+	}
+	serial_ns = (host_time_ns() - start) / iterations;
+
+	printf("%-4s %8llu ns/set %8llu ns/set serial %3lu allocs  %s\n", fails ? "FAIL" : "OK",
+	       (unsigned long long)ns, (unsigned long long)serial_ns, allocs, path);
+
+	hwids_free(&hw);
+	return !!fails;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-n ITERATIONS] HWIDS_FILE...\n", name);
+	fprintf(stderr, "Check computed CHIDs against fwupdtool hwids dumps and time them.\n");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long iterations = 1000;
+	int opt, fails = 0;
+
+	while ((opt = getopt(argc, argv, "n:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			if (!iterations)
+				iterations = 1;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	InitializeLib(NULL, host_efi_init());
+
+	for (; optind < argc; optind++)
+		fails += check_file(argv[optind], iterations);
+
+	if (fails)
+		printf("%d file(s) had mismatching CHIDs\n", fails);
+
+	return !!fails;
+}
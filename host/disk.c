@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Block devices backed by host disk images.
+ *
+ * Every GPT partition of an image gets its own handle with BlockIo, DiskIo
+ * and PartitionInfo, like the firmware partition driver would create.
+ * Images without GPT are exposed as a single raw disk.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <protocol/partition_info.h>
+
+#include "util.h"
+#include "firmware.h"
+
+struct host_disk {
+	EFI_BLOCK_IO_PROTOCOL block_io;
+	EFI_BLOCK_IO_MEDIA media;
+	EFI_DISK_IO_PROTOCOL disk_io;
+	EFI_PARTITION_INFO_PROTOCOL partition;
+	EFI_HANDLE handle;
+	int fd;
+	UINT64 start;
+	UINT64 size;
+};
+
+static UINT32 next_media_id = 1;
+
+static EFI_STATUS EFIAPI host_read_disk(EFI_DISK_IO_PROTOCOL *this, UINT32 media_id, UINT64 offset,
+					UINTN size, VOID *buf)
+{
+	struct host_disk *disk = container_of(this, struct host_disk, disk_io);
+	ssize_t ret;
+
+	if (media_id != disk->media.MediaId)
+		return EFI_MEDIA_CHANGED;
+
+	if (offset + size > disk->size)
+		return EFI_INVALID_PARAMETER;
+
+	host_stats.disk_reads++;
+	host_stats.disk_read_bytes += size;
+
+	ret = pread(disk->fd, buf, size, disk->start + offset);
+	if (ret < 0 || (UINTN)ret != size)
+		return EFI_DEVICE_ERROR;
+
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_read_blocks(EFI_BLOCK_IO_PROTOCOL *this, UINT32 media_id, EFI_LBA lba,
+					  UINTN size, VOID *buf)
+{
+	struct host_disk *disk = container_of(this, struct host_disk, block_io);
+
+	if (size % disk->media.BlockSize)
+		return EFI_BAD_BUFFER_SIZE;
+
+	return host_read_disk(&disk->disk_io, media_id, lba * disk->media.BlockSize, size, buf);
+}
+
+static struct host_disk *new_disk(int fd, UINT64 start, UINT64 size, UINT32 block_size)
+{
+	EFI_GUID block_io_guid = EFI_BLOCK_IO_PROTOCOL_GUID;
+	EFI_GUID disk_io_guid = EFI_DISK_IO_PROTOCOL_GUID;
+	struct host_disk *disk = calloc(1, sizeof(*disk));
+
+	disk->handle = host_new_handle();
+	disk->fd = fd;
+	disk->start = start;
+	disk->size = size;
+
+	disk->media.MediaId = next_media_id++;
+	disk->media.MediaPresent = TRUE;
+	disk->media.ReadOnly = TRUE;
+	disk->media.LogicalPartition = !!start;
+	disk->media.BlockSize = block_size;
+	disk->media.LastBlock = size / block_size - 1;
+
+	disk->block_io.Revision = EFI_BLOCK_IO_PROTOCOL_REVISION;
+	disk->block_io.Media = &disk->media;
+	disk->block_io.ReadBlocks = host_read_blocks;
+
+	disk->disk_io.Revision = EFI_DISK_IO_PROTOCOL_REVISION;
+	disk->disk_io.ReadDisk = host_read_disk;
+
+	host_add_protocol(disk->handle, &block_io_guid, &disk->block_io);
+	host_add_protocol(disk->handle, &disk_io_guid, &disk->disk_io);
+
+	return disk;
+}
+
+struct gpt_header {
+	UINT8 signature[8];
+	UINT32 revision;
+	UINT32 header_size;
+	UINT32 header_crc;
+	UINT32 reserved;
+	UINT64 my_lba;
+	UINT64 alternate_lba;
+	UINT64 first_usable_lba;
+	UINT64 last_usable_lba;
+	EFI_GUID disk_guid;
+	UINT64 entries_lba;
+	UINT32 entry_count;
+	UINT32 entry_size;
+	UINT32 entries_crc;
+} __attribute__((packed));
+
+/**
+ * add_gpt_partitions() - Create partition handles, return their count or -1 if there is no GPT.
+ */
+static int add_gpt_partitions(int fd, UINT64 disk_size, UINT32 block_size)
+{
+	EFI_GUID pi_guid = EFI_PARTITION_INFO_PROTOCOL_GUID;
+	static const EFI_GUID unused = { 0 };
+	struct gpt_header hdr;
+	EFI_PARTITION_ENTRY entry;
+	struct host_disk *part;
+	int count = 0;
+	UINT32 i;
+
+	if (pread(fd, &hdr, sizeof(hdr), block_size) != sizeof(hdr))
+		return -1;
+
+	if (memcmp(hdr.signature, "EFI PART", sizeof(hdr.signature)))
+		return -1;
+
+	if (hdr.entry_size < sizeof(entry))
+		return -1;
+
+	for (i = 0; i < hdr.entry_count; ++i) {
+		UINT64 offset = hdr.entries_lba * block_size + (UINT64)i * hdr.entry_size;
+
+		if (pread(fd, &entry, sizeof(entry), offset) != sizeof(entry))
+			break;
+
+		if (!memcmp(&entry.PartitionTypeGUID, &unused, sizeof(unused)))
+			continue;
+
+		if (entry.EndingLBA < entry.StartingLBA ||
+		    (entry.EndingLBA + 1) * block_size > disk_size)
+			continue;
+
+		part = new_disk(fd, entry.StartingLBA * block_size,
+				(entry.EndingLBA - entry.StartingLBA + 1) * block_size, block_size);
+
+		part->partition.Revision = EFI_PARTITION_INFO_PROTOCOL_REVISION;
+		part->partition.Type = PARTITION_TYPE_GPT;
+		part->partition.Info.Gpt = entry;
+
+		host_add_protocol(part->handle, &pi_guid, &part->partition);
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * host_disk_add() - Expose a disk image, return the number of handles created or -1.
+ */
+int host_disk_add(const char *path)
+{
+	static const UINT32 block_sizes[] = { 512, 4096 };
+	struct stat st;
+	size_t i;
+	int fd, ret;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st)) {
+		close(fd);
+		return -1;
+	}
+
+	/* Like the firmware, the whole disk gets a handle too. */
+	new_disk(fd, 0, st.st_size, block_sizes[0]);
+
+	for (i = 0; i < ARRAY_SIZE(block_sizes); ++i) {
+		ret = add_gpt_partitions(fd, st.st_size, block_sizes[i]);
+		if (ret >= 0)
+			return ret + 1;
+	}
+
+	return 1;
+}
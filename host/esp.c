@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * EFI_SIMPLE_FILE_SYSTEM_PROTOCOL backed by a host directory.
+ */
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "firmware.h"
+
+struct host_file {
+	EFI_FILE_PROTOCOL proto;
+	char path[PATH_MAX];
+	FILE *f;
+};
+
+static char esp_root[PATH_MAX];
+
+static EFI_FILE_PROTOCOL file_proto;
+
+/**
+ * lookup_component() - Append a path component, matching it case-insensitively like FAT.
+ */
+static void lookup_component(char *path, const char *name)
+{
+	size_t len = strlen(path);
+	struct dirent *ent;
+	DIR *dir;
+
+	dir = opendir(path);
+	if (dir) {
+		while ((ent = readdir(dir))) {
+			if (!strcasecmp(ent->d_name, name)) {
+				name = ent->d_name;
+				break;
+			}
+		}
+	}
+
+	snprintf(path + len, PATH_MAX - len, "/%s", name);
+
+	if (dir)
+		closedir(dir);
+}
+
+static void resolve_path(struct host_file *base, const CHAR16 *name, char *out)
+{
+	char component[256];
+	size_t len = 0;
+
+	if (*name == L'\\') {
+		strcpy(out, esp_root);
+		name++;
+	} else {
+		strcpy(out, base->path);
+	}
+
+	for (;; name++) {
+		if (*name && *name != L'\\') {
+			if (len < sizeof(component) - 1)
+				component[len++] = *name < 0x80 ? *name : '_';
+			continue;
+		}
+
+		component[len] = '\0';
+
+		if (!strcmp(component, "..")) {
+			char *slash = strrchr(out, '/');
+
+			if (slash && strlen(out) > strlen(esp_root))
+				*slash = '\0';
+		} else if (len && strcmp(component, ".")) {
+			lookup_component(out, component);
+		}
+
+		len = 0;
+		if (!*name)
+			break;
+	}
+}
+
+static struct host_file *new_file(const char *path, FILE *f)
+{
+	struct host_file *file = calloc(1, sizeof(*file));
+
+	file->proto = file_proto;
+	file->f = f;
+	snprintf(file->path, sizeof(file->path), "%s", path);
+
+	return file;
+}
+
+static EFI_STATUS EFIAPI host_file_open(EFI_FILE_HANDLE this, EFI_FILE_HANDLE *new, CHAR16 *name,
+					UINT64 mode, UINT64 attrs)
+{
+	struct host_file *base = container_of(this, struct host_file, proto);
+	char path[PATH_MAX];
+	struct stat st;
+	FILE *f = NULL;
+
+	resolve_path(base, name, path);
+	host_stats.file_opens++;
+
+	if (stat(path, &st)) {
+		if (!(mode & EFI_FILE_MODE_CREATE))
+			return EFI_NOT_FOUND;
+
+		f = fopen(path, "w+b");
+	} else if (!S_ISDIR(st.st_mode)) {
+		f = fopen(path, (mode & EFI_FILE_MODE_WRITE) ? "r+b" : "rb");
+	}
+
+	if (!f && !S_ISDIR(st.st_mode))
+		return EFI_ACCESS_DENIED;
+
+	*new = &new_file(path, f)->proto;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_file_close(EFI_FILE_HANDLE this)
+{
+	struct host_file *file = container_of(this, struct host_file, proto);
+
+	if (file->f)
+		fclose(file->f);
+	free(file);
+
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_file_read(EFI_FILE_HANDLE this, UINTN *size, VOID *buf)
+{
+	struct host_file *file = container_of(this, struct host_file, proto);
+
+	if (!file->f)
+		return EFI_UNSUPPORTED;
+
+	*size = fread(buf, 1, *size, file->f);
+
+	host_stats.file_reads++;
+	host_stats.file_read_bytes += *size;
+
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_file_write(EFI_FILE_HANDLE this, UINTN *size, VOID *buf)
+{
+	struct host_file *file = container_of(this, struct host_file, proto);
+
+	if (!file->f)
+		return EFI_UNSUPPORTED;
+
+	*size = fwrite(buf, 1, *size, file->f);
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_file_get_position(EFI_FILE_HANDLE this, UINT64 *pos)
+{
+	struct host_file *file = container_of(this, struct host_file, proto);
+
+	if (!file->f)
+		return EFI_UNSUPPORTED;
+
+	*pos = ftell(file->f);
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_file_set_position(EFI_FILE_HANDLE this, UINT64 pos)
+{
+	struct host_file *file = container_of(this, struct host_file, proto);
+
+	if (!file->f)
+		return EFI_UNSUPPORTED;
+
+	if (pos == ~0ULL)
+		fseek(file->f, 0, SEEK_END);
+	else
+		fseek(file->f, pos, SEEK_SET);
+
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_file_get_info(EFI_FILE_HANDLE this, EFI_GUID *type, UINTN *size, VOID *buf)
+{
+	struct host_file *file = container_of(this, struct host_file, proto);
+	const char *name = strrchr(file->path, '/') + 1;
+	UINTN needed = SIZE_OF_EFI_FILE_INFO + (strlen(name) + 1) * sizeof(CHAR16);
+	EFI_FILE_INFO *info = buf;
+	struct stat st;
+	size_t i;
+
+	if (CompareGuid(type, &GenericFileInfo))
+		return EFI_UNSUPPORTED;
+
+	if (*size < needed) {
+		*size = needed;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+
+	if (stat(file->path, &st))
+		return EFI_DEVICE_ERROR;
+
+	memset(info, 0, needed);
+	info->Size = needed;
+	info->FileSize = st.st_size;
+	info->PhysicalSize = st.st_blocks * 512;
+	info->Attribute = S_ISDIR(st.st_mode) ? EFI_FILE_DIRECTORY : 0;
+
+	for (i = 0; name[i]; ++i)
+		info->FileName[i] = name[i];
+
+	*size = needed;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_file_flush(EFI_FILE_HANDLE this)
+{
+	struct host_file *file = container_of(this, struct host_file, proto);
+
+	if (file->f)
+		fflush(file->f);
+
+	return EFI_SUCCESS;
+}
+
+static EFI_FILE_PROTOCOL file_proto = {
+	.Revision = EFI_FILE_PROTOCOL_REVISION,
+	.Open = host_file_open,
+	.Close = host_file_close,
+	.Read = host_file_read,
+	.Write = host_file_write,
+	.GetPosition = host_file_get_position,
+	.SetPosition = host_file_set_position,
+	.GetInfo = host_file_get_info,
+	.Flush = host_file_flush,
+};
+
+static EFI_STATUS EFIAPI host_open_volume(EFI_FILE_IO_INTERFACE *this, EFI_FILE_HANDLE *root)
+{
+	*root = &new_file(esp_root, NULL)->proto;
+	return EFI_SUCCESS;
+}
+
+static EFI_FILE_IO_INTERFACE simple_fs = {
+	.Revision = EFI_FILE_IO_INTERFACE_REVISION,
+	.OpenVolume = host_open_volume,
+};
+
+/**
+ * host_esp_init() - Create a partition handle serving files from @dir.
+ */
+EFI_HANDLE host_esp_init(const char *dir)
+{
+	EFI_GUID fs_guid = EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID;
+	EFI_HANDLE handle = host_new_handle();
+
+	if (!realpath(dir, esp_root))
+		snprintf(esp_root, sizeof(esp_root), "%s", dir);
+
+	host_add_protocol(handle, &fs_guid, &simple_fs);
+
+	return handle;
+}
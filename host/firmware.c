@@ -0,0 +1,553 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "util.h"
+#include "timing.h"
+#include "firmware.h"
+
+struct host_stats host_stats;
+bool host_quiet;
+
+#define MAX_CONFIG_TABLES	16
+#define MAX_HANDLES		64
+#define MAX_PROTOCOLS		8
+#define MAX_VARIABLES		64
+
+static EFI_CONFIGURATION_TABLE config_tables[MAX_CONFIG_TABLES];
+
+struct host_handle {
+	int count;
+	EFI_GUID guids[MAX_PROTOCOLS];
+	void *ifaces[MAX_PROTOCOLS];
+};
+
+static struct host_handle handles[MAX_HANDLES];
+static int handle_count;
+
+struct host_variable {
+	CHAR16 name[64];
+	EFI_GUID guid;
+	UINT32 attrs;
+	UINTN size;
+	UINT8 *data;
+};
+
+static struct host_variable variables[MAX_VARIABLES];
+static int variable_count;
+
+static bool guid_eq(const EFI_GUID *a, const EFI_GUID *b)
+{
+	return !memcmp(a, b, sizeof(*a));
+}
+
+static bool str16_eq(const CHAR16 *a, const CHAR16 *b)
+{
+	while (*a && *a == *b) {
+		a++;
+		b++;
+	}
+
+	return *a == *b;
+}
+
+/*
+ * Console
+ */
+
+static EFI_STATUS EFIAPI host_output_string(SIMPLE_TEXT_OUTPUT_INTERFACE *this, CHAR16 *str)
+{
+	if (host_quiet)
+		return EFI_SUCCESS;
+
+	for (; *str; str++) {
+		if (*str == L'\r')
+			continue;
+
+		putchar(*str < 0x80 ? *str : '?');
+	}
+
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_set_attribute(SIMPLE_TEXT_OUTPUT_INTERFACE *this, UINTN attr)
+{
+	return EFI_SUCCESS;
+}
+
+static SIMPLE_TEXT_OUTPUT_MODE con_out_mode = {
+	.MaxMode = 1,
+	.Attribute = EFI_TEXT_ATTR(EFI_LIGHTGRAY, EFI_BLACK),
+};
+
+static SIMPLE_TEXT_OUTPUT_INTERFACE con_out = {
+	.OutputString = host_output_string,
+	.SetAttribute = host_set_attribute,
+	.Mode = &con_out_mode,
+};
+
+/* Every key press is instant, so Pause() doesn't block the host tools. */
+static EFI_STATUS EFIAPI host_read_key_stroke(SIMPLE_INPUT_INTERFACE *this, EFI_INPUT_KEY *key)
+{
+	key->ScanCode = 0;
+	key->UnicodeChar = L' ';
+	return EFI_SUCCESS;
+}
+
+static SIMPLE_INPUT_INTERFACE con_in = {
+	.ReadKeyStroke = host_read_key_stroke,
+	.WaitForKey = (EFI_EVENT)&con_in,
+};
+
+/*
+ * Boot services
+ */
+
+static EFI_TPL EFIAPI host_raise_tpl(EFI_TPL tpl)
+{
+	return TPL_APPLICATION;
+}
+
+static VOID EFIAPI host_restore_tpl(EFI_TPL tpl)
+{
+}
+
+static EFI_STATUS EFIAPI host_allocate_pool(EFI_MEMORY_TYPE type, UINTN size, VOID **buf)
+{
+	*buf = malloc(size ? size : 1);
+	if (!*buf)
+		return EFI_OUT_OF_RESOURCES;
+
+	host_stats.pool_allocs++;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_free_pool(VOID *buf)
+{
+	free(buf);
+	host_stats.pool_frees++;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_allocate_pages(EFI_ALLOCATE_TYPE type, EFI_MEMORY_TYPE mem_type,
+					     UINTN pages, EFI_PHYSICAL_ADDRESS *addr)
+{
+	void *buf;
+
+	if (type != AllocateAnyPages)
+		return EFI_UNSUPPORTED;
+
+	buf = aligned_alloc(EFI_PAGE_SIZE, pages * EFI_PAGE_SIZE);
+	if (!buf)
+		return EFI_OUT_OF_RESOURCES;
+
+	host_stats.page_allocs += pages;
+	*addr = (EFI_PHYSICAL_ADDRESS)(uintptr_t)buf;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_free_pages(EFI_PHYSICAL_ADDRESS addr, UINTN pages)
+{
+	free((void *)(uintptr_t)addr);
+	host_stats.page_frees += pages;
+	return EFI_SUCCESS;
+}
+
+/* Events are never signalled asynchronously, waiting on anything returns at once. */
+static int dummy_event;
+
+static EFI_STATUS EFIAPI host_create_event(UINT32 type, EFI_TPL tpl, EFI_EVENT_NOTIFY notify,
+					   VOID *ctx, EFI_EVENT *event)
+{
+	*event = &dummy_event;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_set_timer(EFI_EVENT event, EFI_TIMER_DELAY type, UINT64 time)
+{
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_wait_for_event(UINTN count, EFI_EVENT *events, UINTN *index)
+{
+	*index = 0;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_close_event(EFI_EVENT event)
+{
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_handle_protocol(EFI_HANDLE handle, EFI_GUID *guid, VOID **iface)
+{
+	struct host_handle *h = handle;
+	int i;
+
+	if (!h)
+		return EFI_INVALID_PARAMETER;
+
+	for (i = 0; i < h->count; ++i) {
+		if (guid_eq(&h->guids[i], guid)) {
+			*iface = h->ifaces[i];
+			return EFI_SUCCESS;
+		}
+	}
+
+	return EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI host_locate_handle(EFI_LOCATE_SEARCH_TYPE type, EFI_GUID *guid, VOID *key,
+					    UINTN *size, EFI_HANDLE *buf)
+{
+	UINTN count = 0, needed = 0;
+	VOID *iface;
+	int i;
+
+	if (type != AllHandles && type != ByProtocol)
+		return EFI_UNSUPPORTED;
+
+	for (i = 0; i < handle_count; ++i)
+		if (type == AllHandles || !host_handle_protocol(&handles[i], guid, &iface))
+			needed += sizeof(EFI_HANDLE);
+
+	if (!needed)
+		return EFI_NOT_FOUND;
+
+	if (*size < needed) {
+		*size = needed;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+
+	for (i = 0; i < handle_count; ++i)
+		if (type == AllHandles || !host_handle_protocol(&handles[i], guid, &iface))
+			buf[count++] = &handles[i];
+
+	*size = needed;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_locate_protocol(EFI_GUID *guid, VOID *registration, VOID **iface)
+{
+	int i;
+
+	for (i = 0; i < handle_count; ++i)
+		if (!host_handle_protocol(&handles[i], guid, iface))
+			return EFI_SUCCESS;
+
+	return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI host_get_next_monotonic_count(UINT64 *count)
+{
+	static UINT64 counter;
+
+	*count = counter++;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_install_protocol_interface(EFI_HANDLE *handle, EFI_GUID *guid,
+							 EFI_INTERFACE_TYPE type, VOID *iface)
+{
+	if (!*handle)
+		*handle = host_new_handle();
+
+	host_add_protocol(*handle, guid, iface);
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_install_configuration_table(EFI_GUID *guid, VOID *table)
+{
+	host_set_config_table(guid, table);
+	return EFI_SUCCESS;
+}
+
+/*
+ * Runtime services
+ */
+
+static struct host_variable *find_variable(const CHAR16 *name, const EFI_GUID *guid)
+{
+	int i;
+
+	for (i = 0; i < variable_count; ++i)
+		if (guid_eq(&variables[i].guid, guid) && str16_eq(variables[i].name, name))
+			return &variables[i];
+
+	return NULL;
+}
+
+static EFI_STATUS EFIAPI host_get_variable(CHAR16 *name, EFI_GUID *guid, UINT32 *attrs,
+					   UINTN *size, VOID *data)
+{
+	struct host_variable *var = find_variable(name, guid);
+
+	host_stats.var_reads++;
+
+	if (!var)
+		return EFI_NOT_FOUND;
+
+	if (attrs)
+		*attrs = var->attrs;
+
+	if (*size < var->size) {
+		*size = var->size;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+
+	memcpy(data, var->data, var->size);
+	*size = var->size;
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI host_set_variable(CHAR16 *name, EFI_GUID *guid, UINT32 attrs,
+					   UINTN size, VOID *data)
+{
+	struct host_variable *var = find_variable(name, guid);
+	int i;
+
+	host_stats.var_writes++;
+
+	if (!size) {
+		if (!var)
+			return EFI_NOT_FOUND;
+
+		free(var->data);
+		*var = variables[--variable_count];
+		return EFI_SUCCESS;
+	}
+
+	if (!var) {
+		if (variable_count == MAX_VARIABLES)
+			return EFI_OUT_OF_RESOURCES;
+
+		var = &variables[variable_count++];
+		memset(var, 0, sizeof(*var));
+
+		for (i = 0; name[i] && i < ARRAY_SIZE(var->name) - 1; ++i)
+			var->name[i] = name[i];
+		var->guid = *guid;
+	}
+
+	free(var->data);
+	var->data = malloc(size);
+	memcpy(var->data, data, size);
+	var->size = size;
+	var->attrs = attrs;
+
+	return EFI_SUCCESS;
+}
+
+static EFI_BOOT_SERVICES boot_services = {
+	.RaiseTPL = host_raise_tpl,
+	.RestoreTPL = host_restore_tpl,
+	.AllocatePages = host_allocate_pages,
+	.FreePages = host_free_pages,
+	.AllocatePool = host_allocate_pool,
+	.FreePool = host_free_pool,
+	.CreateEvent = host_create_event,
+	.SetTimer = host_set_timer,
+	.WaitForEvent = host_wait_for_event,
+	.CloseEvent = host_close_event,
+	.InstallProtocolInterface = host_install_protocol_interface,
+	.HandleProtocol = host_handle_protocol,
+	.LocateHandle = host_locate_handle,
+	.InstallConfigurationTable = host_install_configuration_table,
+	.LocateProtocol = host_locate_protocol,
+	.GetNextMonotonicCount = host_get_next_monotonic_count,
+};
+
+static EFI_RUNTIME_SERVICES runtime_services = {
+	.GetVariable = host_get_variable,
+	.SetVariable = host_set_variable,
+};
+
+static EFI_SYSTEM_TABLE system_table = {
+	.ConIn = &con_in,
+	.ConOut = &con_out,
+	.BootServices = &boot_services,
+	.RuntimeServices = &runtime_services,
+	.ConfigurationTable = config_tables,
+};
+
+/**
+ * host_set_config_table() - Add, replace or remove (@table = NULL) a config table.
+ */
+void host_set_config_table(EFI_GUID *guid, void *table)
+{
+	UINTN i;
+
+	for (i = 0; i < system_table.NumberOfTableEntries; ++i) {
+		if (!guid_eq(&config_tables[i].VendorGuid, guid))
+			continue;
+
+		if (table)
+			config_tables[i].VendorTable = table;
+		else
+			config_tables[i] = config_tables[--system_table.NumberOfTableEntries];
+
+		return;
+	}
+
+	if (!table || system_table.NumberOfTableEntries == MAX_CONFIG_TABLES)
+		return;
+
+	config_tables[i].VendorGuid = *guid;
+	config_tables[i].VendorTable = table;
+	system_table.NumberOfTableEntries++;
+}
+
+EFI_HANDLE host_new_handle(void)
+{
+	if (handle_count == MAX_HANDLES) {
+		fprintf(stderr, "Out of mock handles\n");
+		abort();
+	}
+
+	return &handles[handle_count++];
+}
+
+void host_add_protocol(EFI_HANDLE handle, EFI_GUID *guid, void *iface)
+{
+	struct host_handle *h = handle;
+
+	if (h->count == MAX_PROTOCOLS) {
+		fprintf(stderr, "Out of mock protocol slots\n");
+		abort();
+	}
+
+	h->guids[h->count] = *guid;
+	h->ifaces[h->count] = iface;
+	h->count++;
+}
+
+/**
+ * host_new_image() - Create a handle for an image loaded from @device.
+ */
+EFI_HANDLE host_new_image(EFI_HANDLE device)
+{
+	EFI_GUID lip_guid = EFI_LOADED_IMAGE_PROTOCOL_GUID;
+	EFI_LOADED_IMAGE *image = calloc(1, sizeof(*image));
+	EFI_HANDLE handle = host_new_handle();
+
+	image->Revision = EFI_LOADED_IMAGE_PROTOCOL_REVISION;
+	image->SystemTable = &system_table;
+	image->DeviceHandle = device;
+	image->ImageCodeType = EfiBootServicesCode;
+	image->ImageDataType = EfiBootServicesData;
+
+	host_add_protocol(handle, &lip_guid, image);
+
+	return handle;
+}
+
+static int hex_nibble(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/**
+ * host_vars_load() - Load NV variables from a file.
+ *
+ * Every line is "Name-GUID HEXDATA", names are the same as in efivarfs:
+ *
+ *   SecureBoot-8be4df61-93ca-11d2-aa0d-00e098032b8c 01
+ */
+int host_vars_load(const char *path)
+{
+	UINT32 attrs = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS |
+		       EFI_VARIABLE_RUNTIME_ACCESS;
+	char line[4096], *data;
+	unsigned int d[11];
+	UINT8 buf[2048];
+	CHAR16 name[64];
+	EFI_GUID guid;
+	size_t len, i;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		data = strchr(line, ' ');
+		if (line[0] == '#' || !data)
+			continue;
+
+		*data++ = '\0';
+		len = strlen(line);
+
+		/* Name, dash and a GUID */
+		if (len < 38 || len - 37 >= ARRAY_SIZE(name))
+			continue;
+
+		if (sscanf(line + len - 36, "%8x-%4x-%4x-%2x%2x-%2x%2x%2x%2x%2x%2x",
+			   &d[0], &d[1], &d[2], &d[3], &d[4], &d[5], &d[6],
+			   &d[7], &d[8], &d[9], &d[10]) != 11)
+			continue;
+
+		guid.Data1 = d[0];
+		guid.Data2 = d[1];
+		guid.Data3 = d[2];
+		for (i = 0; i < 8; ++i)
+			guid.Data4[i] = d[3 + i];
+
+		for (i = 0; i < len - 37; ++i)
+			name[i] = line[i];
+		name[i] = 0;
+
+		for (len = 0; len < sizeof(buf); ++len) {
+			int hi = hex_nibble(data[2 * len]);
+			int lo = hi < 0 ? -1 : hex_nibble(data[2 * len + 1]);
+
+			if (lo < 0)
+				break;
+
+			buf[len] = hi << 4 | lo;
+		}
+
+		if (len)
+			host_set_variable(name, &guid, attrs, len, buf);
+	}
+
+	host_stats.var_writes = 0;
+
+	fclose(f);
+	return 0;
+}
+
+EFI_SYSTEM_TABLE *host_efi_init(void)
+{
+	return &system_table;
+}
+
+UINT64 host_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+UINT64 timer_ticks(void)
+{
+	return host_time_ns();
+}
+
+UINT64 timer_freq(void)
+{
+	return 1000000000ULL;
+}
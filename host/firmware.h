@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef HOST_FIRMWARE_H
+#define HOST_FIRMWARE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <efi.h>
+
+/*
+ * Minimal mock of the firmware side of UEFI so dtbloader sources and
+ * gnu-efi can run as a normal host process. Only the services we
+ * actually use are implemented, anything else is left NULL on purpose
+ * so the host tools crash loudly instead of silently doing nothing.
+ */
+
+struct host_stats {
+	unsigned long pool_allocs;
+	unsigned long pool_frees;
+	unsigned long page_allocs;
+	unsigned long page_frees;
+	unsigned long file_opens;
+	unsigned long file_reads;
+	unsigned long file_read_bytes;
+	unsigned long disk_reads;
+	unsigned long disk_read_bytes;
+	unsigned long var_reads;
+	unsigned long var_writes;
+};
+
+extern struct host_stats host_stats;
+extern bool host_quiet;
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+EFI_SYSTEM_TABLE *host_efi_init(void);
+void host_set_config_table(EFI_GUID *guid, void *table);
+
+EFI_HANDLE host_new_handle(void);
+void host_add_protocol(EFI_HANDLE handle, EFI_GUID *guid, void *iface);
+EFI_HANDLE host_new_image(EFI_HANDLE device);
+
+int host_vars_load(const char *path);
+
+/* esp.c */
+EFI_HANDLE host_esp_init(const char *dir);
+
+/* disk.c */
+int host_disk_add(const char *path);
+
+UINT64 host_time_ns(void);
+
+#endif
@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "smbios.h"
+#include "firmware.h"
+#include "hwids.h"
+
+static const char * const field_names[HWIDS_FIELD_COUNT] = {
+	[HWIDS_MANUFACTURER]		= "Manufacturer",
+	[HWIDS_FAMILY]			= "Family",
+	[HWIDS_PRODUCT_NAME]		= "ProductName",
+	[HWIDS_PRODUCT_SKU]		= "ProductSku",
+	[HWIDS_BASEBOARD_MANUFACTURER]	= "BaseboardManufacturer",
+	[HWIDS_BASEBOARD_PRODUCT]	= "BaseboardProduct",
+};
+
+/* CHIDs that don't use BIOS or enclosure fields, see chid.c */
+static const char * const chid_fields[HWIDS_CHID_COUNT] = {
+	[3]  = "Manufacturer + Family + ProductName + ProductSku + BaseboardManufacturer + BaseboardProduct",
+	[4]  = "Manufacturer + Family + ProductName + ProductSku",
+	[5]  = "Manufacturer + Family + ProductName",
+	[6]  = "Manufacturer + ProductSku + BaseboardManufacturer + BaseboardProduct",
+	[7]  = "Manufacturer + ProductSku",
+	[8]  = "Manufacturer + ProductName + BaseboardManufacturer + BaseboardProduct",
+	[9]  = "Manufacturer + ProductName",
+	[10] = "Manufacturer + Family + BaseboardManufacturer + BaseboardProduct",
+	[11] = "Manufacturer + Family",
+	[13] = "Manufacturer + BaseboardManufacturer + BaseboardProduct",
+	[14] = "Manufacturer",
+};
+
+static void strip_newline(char *line)
+{
+	size_t len = strlen(line);
+
+	while (len && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+		line[--len] = '\0';
+}
+
+static int parse_chid(const char *line, struct hwids *hw)
+{
+	unsigned int d1, d2, d3, d4[8];
+	const char *fields;
+	EFI_GUID *chid;
+	int i;
+
+	if (sscanf(line, "{%8x-%4x-%4x-%2x%2x-%2x%2x%2x%2x%2x%2x}",
+		   &d1, &d2, &d3, &d4[0], &d4[1], &d4[2], &d4[3],
+		   &d4[4], &d4[5], &d4[6], &d4[7]) != 11)
+		return -1;
+
+	fields = strstr(line, "<- ");
+	if (!fields)
+		return -1;
+	fields += 3;
+
+	for (i = 0; i < HWIDS_CHID_COUNT; ++i) {
+		if (!chid_fields[i] || strcmp(fields, chid_fields[i]))
+			continue;
+
+		chid = &hw->chids[i];
+		chid->Data1 = d1;
+		chid->Data2 = d2;
+		chid->Data3 = d3;
+		for (d1 = 0; d1 < 8; ++d1)
+			chid->Data4[d1] = d4[d1];
+
+		hw->has_chid[i] = true;
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * hwids_parse() - Parse a "fwupdtool hwids" dump like the ones in scripts/hwids.
+ */
+int hwids_parse(const char *path, struct hwids *hw)
+{
+	char line[512];
+	FILE *f;
+	int i;
+
+	memset(hw, 0, sizeof(*hw));
+
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		strip_newline(line);
+
+		if (line[0] == '{') {
+			if (parse_chid(line, hw)) {
+				fclose(f);
+				return -1;
+			}
+			continue;
+		}
+
+		for (i = 0; i < HWIDS_FIELD_COUNT; ++i) {
+			size_t len = strlen(field_names[i]);
+
+			if (!strncmp(line, field_names[i], len) && !strncmp(line + len, ": ", 2)) {
+				free(hw->fields[i]);
+				hw->fields[i] = strdup(line + len + 2);
+				break;
+			}
+		}
+	}
+
+	fclose(f);
+	return 0;
+}
+
+void hwids_free(struct hwids *hw)
+{
+	int i;
+
+	for (i = 0; i < HWIDS_FIELD_COUNT; ++i)
+		free(hw->fields[i]);
+
+	memset(hw, 0, sizeof(*hw));
+}
+
+struct smbios_builder {
+	UINT8 *buf;
+	size_t len;
+	size_t size;
+};
+
+static void put(struct smbios_builder *b, const void *data, size_t len)
+{
+	if (b->len + len > b->size) {
+		b->size = (b->len + len) * 2;
+		b->buf = realloc(b->buf, b->size);
+		if (!b->buf)
+			abort();
+	}
+
+	memcpy(b->buf + b->len, data, len);
+	b->len += len;
+}
+
+/**
+ * put_struct() - Append an SMBIOS structure with its string set.
+ * @raw:     Formatted area, string numbers will be filled in.
+ * @len:     Size of @raw.
+ * @refs:    Offsets of the string number fields in @raw.
+ * @strings: Strings matching @refs, NULL for missing ones.
+ * @count:   Amount of strings.
+ */
+static void put_struct(struct smbios_builder *b, UINT8 *raw, size_t len,
+		       const size_t *refs, char * const *strings, int count)
+{
+	UINT8 nr = 0;
+	int i;
+
+	for (i = 0; i < count; ++i)
+		raw[refs[i]] = strings[i] ? ++nr : 0;
+
+	put(b, raw, len);
+
+	for (i = 0; i < count; ++i)
+		if (strings[i])
+			put(b, strings[i], strlen(strings[i]) + 1);
+
+	/* The string set always ends with a double NUL. */
+	put(b, "\0", nr ? 1 : 2);
+}
+
+/**
+ * hwids_build_smbios() - Build a minimal SMBIOS table with type 1 and 2 structures.
+ */
+void *hwids_build_smbios(const struct hwids *hw, size_t *len)
+{
+	struct smbios_builder b = { 0 };
+	UINT8 type1[0x1b] = { 1, sizeof(type1), 0x01, 0x00 };
+	UINT8 type2[0x08] = { 2, sizeof(type2), 0x02, 0x00 };
+	UINT8 type127[0x04] = { 127, sizeof(type127), 0x7f, 0x00 };
+	const size_t type1_refs[] = { 0x04, 0x05, 0x19, 0x1a };
+	char * const type1_strings[] = {
+		hw->fields[HWIDS_MANUFACTURER],
+		hw->fields[HWIDS_PRODUCT_NAME],
+		hw->fields[HWIDS_PRODUCT_SKU],
+		hw->fields[HWIDS_FAMILY],
+	};
+	const size_t type2_refs[] = { 0x04, 0x05 };
+	char * const type2_strings[] = {
+		hw->fields[HWIDS_BASEBOARD_MANUFACTURER],
+		hw->fields[HWIDS_BASEBOARD_PRODUCT],
+	};
+
+	put_struct(&b, type1, sizeof(type1), type1_refs, type1_strings, 4);
+	put_struct(&b, type2, sizeof(type2), type2_refs, type2_strings, 2);
+	put_struct(&b, type127, sizeof(type127), NULL, NULL, 0);
+
+	*len = b.len;
+	return b.buf;
+}
+
+/**
+ * hwids_install_smbios() - Replace the SMBIOS3 config table with one built from @hw.
+ */
+void hwids_install_smbios(const struct hwids *hw)
+{
+	static SMBIOS3_STRUCTURE_TABLE entry;
+	static void *table;
+	size_t len;
+
+	free(table);
+	table = hwids_build_smbios(hw, &len);
+
+	memset(&entry, 0, sizeof(entry));
+	memcpy(entry.AnchorString, "_SM3_", sizeof(entry.AnchorString));
+	entry.EntryPointLength = sizeof(entry);
+	entry.MajorVersion = 3;
+	entry.TableMaximumSize = len;
+	entry.TableAddress = (UINT64)(uintptr_t)table;
+
+	host_set_config_table(&SMBIOS3TableGuid, &entry);
+	smbios_reset();
+}
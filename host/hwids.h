@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef HOST_HWIDS_H
+#define HOST_HWIDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <efi.h>
+
+enum hwids_field {
+	HWIDS_MANUFACTURER,
+	HWIDS_FAMILY,
+	HWIDS_PRODUCT_NAME,
+	HWIDS_PRODUCT_SKU,
+	HWIDS_BASEBOARD_MANUFACTURER,
+	HWIDS_BASEBOARD_PRODUCT,
+	HWIDS_FIELD_COUNT,
+};
+
+#define HWIDS_CHID_COUNT	15
+
+/**
+ * struct hwids - Parsed "fwupdtool hwids" output.
+ * @fields:    SMBIOS strings, NULL if not present.
+ * @chids:     CHIDs as computed by fwupd.
+ * @has_chid:  Whether fwupd could compute the CHID with this index.
+ */
+struct hwids {
+	char *fields[HWIDS_FIELD_COUNT];
+	EFI_GUID chids[HWIDS_CHID_COUNT];
+	bool has_chid[HWIDS_CHID_COUNT];
+};
+
+int hwids_parse(const char *path, struct hwids *hw);
+void hwids_free(struct hwids *hw);
+
+void *hwids_build_smbios(const struct hwids *hw, size_t *len);
+void hwids_install_smbios(const struct hwids *hw);
+
+#endif
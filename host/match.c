@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * dtbloader-match - Tell which device and dtb dtbloader will pick.
+ *
+ * Runs the same CHID computation and device lookup as the driver on the
+ * SMBIOS strings of this machine (from /sys/class/dmi/id) or of the given
+ * "fwupdtool hwids" dumps, so installers can copy only the dtb that will
+ * actually be used to the ESP.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "device.h"
+#include "devdb.h"
+#include "rules.h"
+
+#include "firmware.h"
+#include "hwids.h"
+
+#define DMI_DIR		"/sys/class/dmi/id/"
+#define MAX_CANDIDATES	16
+
+/* Exit status when the pick depends on variant checks we can't run here. */
+#define EXIT_AMBIGUOUS	2
+
+static const char * const dmi_files[HWIDS_FIELD_COUNT] = {
+	[HWIDS_MANUFACTURER]		= "sys_vendor",
+	[HWIDS_FAMILY]			= "product_family",
+	[HWIDS_PRODUCT_NAME]		= "product_name",
+	[HWIDS_PRODUCT_SKU]		= "product_sku",
+	[HWIDS_BASEBOARD_MANUFACTURER]	= "board_vendor",
+	[HWIDS_BASEBOARD_PRODUCT]	= "board_name",
+};
+
+static void str16_to_ascii(char *out, const CHAR16 *in, size_t len)
+{
+	size_t i;
+
+	for (i = 0; in[i] && i < len - 1; ++i)
+		out[i] = in[i] < 0x80 ? in[i] : '?';
+	out[i] = '\0';
+}
+
+static void dtb_path(char *out, const CHAR16 *in, size_t len)
+{
+	int i;
+
+	str16_to_ascii(out, in, len);
+
+	/* Same layout as the kernel installs dtbs in. */
+	for (i = 0; out[i]; ++i)
+		if (out[i] == '\\')
+			out[i] = '/';
+}
+
+/**
+ * dmi_read() - Get the SMBIOS strings of this machine from sysfs.
+ */
+static int dmi_read(struct hwids *hw)
+{
+	char path[128], line[256];
+	FILE *f;
+	int i;
+
+	memset(hw, 0, sizeof(*hw));
+
+	for (i = 0; i < HWIDS_FIELD_COUNT; ++i) {
+		snprintf(path, sizeof(path), DMI_DIR "%s", dmi_files[i]);
+
+		f = fopen(path, "r");
+		if (!f)
+			continue;
+
+		if (fgets(line, sizeof(line), f)) {
+			line[strcspn(line, "\n")] = '\0';
+			hw->fields[i] = strdup(line);
+		}
+
+		fclose(f);
+	}
+
+	return hw->fields[HWIDS_MANUFACTURER] ? 0 : -1;
+}
+
+/**
+ * match_one() - Print the device dtbloader picks for @path.
+ * @path:  hwids dump or NULL for this machine.
+ *
+ * Variant checks (.rules and .extra_match) look at ACPI tables and SMBIOS
+ * structures that neither sysfs nor hwids dumps have. If the pick depends
+ * on them, all devices it could be are printed instead.
+ *
+ * Returns: 0 on a match, EXIT_AMBIGUOUS if there are several candidates
+ *          or 1 if the machine isn't supported.
+ */
+static int match_one(const char *path, bool quiet, bool prefix)
+{
+	struct device *cand[MAX_CANDIDATES];
+	char name[128], dtb[128];
+	struct device *dev;
+	struct hwids hw;
+	UINT64 start, ns;
+	UINTN count, i;
+
+	if (path ? hwids_parse(path, &hw) : dmi_read(&hw)) {
+		fprintf(stderr, "%s: failed to read\n", path ?: DMI_DIR);
+		return 1;
+	}
+
+	hwids_install_smbios(&hw);
+	rules_reset();
+
+	start = host_time_ns();
+	dev = detect_device();
+	ns = host_time_ns() - start;
+
+	count = match_candidates(cand, MAX_CANDIDATES);
+
+	hwids_free(&hw);
+
+	if (count && (count > 1 || cand[0]->rules || cand[0]->extra_match)) {
+		if (!quiet)
+			printf("%s%svariant can't be checked here, candidates:\n",
+			       prefix ? path : "", prefix ? ": " : "");
+
+		for (i = 0; i < count; ++i) {
+			str16_to_ascii(name, cand[i]->name, sizeof(name));
+			dtb_path(dtb, cand[i]->dtb, sizeof(dtb));
+
+			if (prefix)
+				printf("%s: ", path);
+
+			if (quiet)
+				printf("%s\n", dtb);
+			else
+				printf("device=\"%s\" dtb=\"%s\"\n", name, dtb);
+		}
+
+		return EXIT_AMBIGUOUS;
+	}
+
+	if (prefix)
+		printf("%s: ", path);
+
+	if (!dev) {
+		printf(quiet ? "\n" : "not supported\n");
+		return 1;
+	}
+
+	str16_to_ascii(name, dev->name, sizeof(name));
+	dtb_path(dtb, dev->dtb, sizeof(dtb));
+
+	if (quiet)
+		printf("%s\n", dtb);
+	else
+		printf("device=\"%s\" dtb=\"%s\" time=%lluus\n", name, dtb,
+		       (unsigned long long)ns / 1000);
+
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-e ESP_DIR] [-q] [HWIDS_FILE...]\n", name);
+	fprintf(stderr, "Print the device and dtb dtbloader picks for this machine or the given fwupdtool hwids dumps.\n");
+	fprintf(stderr, "  -e  Also use \\dtbloader\\devices.db from this directory\n");
+	fprintf(stderr, "  -q  Only print the dtb path\n");
+	fprintf(stderr, "Exits with %d if the dtb depends on variant checks that only dtbloader can do,\n", EXIT_AMBIGUOUS);
+	fprintf(stderr, "all the dtbs it could pick are printed then.\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *esp_dir = NULL;
+	bool quiet = false;
+	int opt, i, ret, fails = 0, ambiguous = 0;
+	EFI_STATUS status;
+
+	InitializeLib(NULL, host_efi_init());
+
+	while ((opt = getopt(argc, argv, "e:qh")) != -1) {
+		switch (opt) {
+		case 'e':
+			esp_dir = optarg;
+			break;
+		case 'q':
+			quiet = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	host_quiet = true;
+
+	if (esp_dir) {
+		status = devdb_load(host_new_image(host_esp_init(esp_dir)));
+		if (EFI_ERROR(status) && status != EFI_NOT_FOUND) {
+			fprintf(stderr, "%s: can't load the device database: 0x%lx\n",
+				esp_dir, (unsigned long)status);
+			return 1;
+		}
+	}
+
+	if (optind >= argc)
+		return match_one(NULL, quiet, false);
+
+	for (i = optind; i < argc; ++i) {
+		ret = match_one(argv[i], quiet, argc - optind > 1);
+		if (ret == EXIT_AMBIGUOUS)
+			ambiguous++;
+		else if (ret)
+			fails++;
+	}
+
+	if (fails)
+		return 1;
+
+	return ambiguous ? EXIT_AMBIGUOUS : 0;
+}
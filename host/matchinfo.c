@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * dtbloader-matchinfo - Decode the DtbloaderMatch variable.
+ *
+ * Reads the detection result published by src/publish.c through efivarfs
+ * (or from a file with a copy of it) and prints the CHIDs in the same
+ * "HardwareID-N" terms fwupd uses, along with what dtbloader matched.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "util.h"
+#include "protocol/dtbloader_match.h"
+
+#define DEFAULT_PATH \
+	"/sys/firmware/efi/efivars/DtbloaderMatch-f8a6489e-2fde-41ac-9525-13942b394f41"
+
+static void print_guid(const EFI_GUID *g)
+{
+	printf("%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+	       g->Data1, g->Data2, g->Data3, g->Data4[0], g->Data4[1],
+	       g->Data4[2], g->Data4[3], g->Data4[4], g->Data4[5],
+	       g->Data4[6], g->Data4[7]);
+}
+
+static void print_name(const char *what, const CHAR16 *str, size_t len)
+{
+	size_t i;
+
+	printf("%s: ", what);
+	for (i = 0; i < len && str[i]; ++i)
+		putchar(str[i] < 0x80 ? str[i] : '?');
+	putchar('\n');
+}
+
+static bool guid_is_zero(const EFI_GUID *g)
+{
+	static const EFI_GUID zero;
+
+	return !memcmp(g, &zero, sizeof(zero));
+}
+
+/**
+ * read_file() - Read all of @path, newer tables may be larger than ours.
+ */
+static unsigned char *read_file(const char *path, size_t *len)
+{
+	unsigned char *buf = NULL, *tmp;
+	size_t size = 0, n;
+	FILE *f;
+
+	f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		return NULL;
+	}
+
+	*len = 0;
+	do {
+		if (*len == size) {
+			size = size ? size * 2 : 4096;
+			tmp = realloc(buf, size);
+			if (!tmp) {
+				perror(path);
+				free(buf);
+				fclose(f);
+				return NULL;
+			}
+			buf = tmp;
+		}
+
+		n = fread(buf + *len, 1, size - *len, f);
+		*len += n;
+	} while (n);
+
+	if (ferror(f)) {
+		perror(path);
+		free(buf);
+		buf = NULL;
+	}
+
+	fclose(f);
+
+	return buf;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [variable]\n"
+		"  Decodes %s by default.\n", name, DEFAULT_PATH);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = DEFAULT_PATH;
+	DTBLOADER_MATCH_TABLE table = {0};
+	unsigned char *buf;
+	size_t len;
+	int i;
+
+	if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (argc == 2)
+		path = argv[1];
+
+	buf = read_file(path, &len);
+	if (!buf)
+		return 1;
+
+	/* efivarfs files start with the variable attributes. */
+	if (len < sizeof(UINT32) + offsetof(DTBLOADER_MATCH_TABLE, Chids)) {
+		fprintf(stderr, "%s: too short\n", path);
+		free(buf);
+		return 1;
+	}
+
+	len -= sizeof(UINT32);
+	memcpy(&table, buf + sizeof(UINT32), len < sizeof(table) ? len : sizeof(table));
+	free(buf);
+
+	if (table.Revision >> 16 != DTBLOADER_MATCH_TABLE_REVISION >> 16) {
+		fprintf(stderr, "%s: unsupported revision %08x\n", path, table.Revision);
+		return 1;
+	}
+
+	/* Only the fields we print have to be there, newer ones are appended. */
+	if (table.Size > len ||
+	    table.Size < offsetof(DTBLOADER_MATCH_TABLE, DtbName) + sizeof(table.DtbName)) {
+		fprintf(stderr, "%s: bad size %u\n", path, table.Size);
+		return 1;
+	}
+
+	printf("dtbloader version: %llu\n", (unsigned long long)table.Version);
+
+	if (table.Flags & DTBLOADER_MATCH_FOUND) {
+		print_name("device", table.DeviceName, ARRAY_SIZE(table.DeviceName));
+		print_name("dtb", table.DtbName, ARRAY_SIZE(table.DtbName));
+		printf("matched: HardwareID-%u, priority level %u%s\n",
+		       table.MatchedChid, table.MatchedLevel,
+		       table.Flags & DTBLOADER_MATCH_DEVDB ? " (devices.db)" : "");
+	} else {
+		printf("device: not supported\n");
+	}
+
+	for (i = 0; i < DTBLOADER_MATCH_CHID_COUNT; ++i) {
+		if (guid_is_zero(&table.Chids[i]))
+			continue;
+
+		printf("HardwareID-%d: ", i);
+		print_guid(&table.Chids[i]);
+		printf("%s\n", i == table.MatchedChid ? " <- matched" : "");
+	}
+
+	return 0;
+}
@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * dtbloader-mkdb - Write the device table as a device database.
+ *
+ * Builds \dtbloader\devices.db (see src/devdb.c) out of the descriptions
+ * in src/devices, so boards added there can be supported by an already
+ * signed dtbloader.efi. Devices with callbacks refer to the built-in
+ * device of the same name, so those only work with a dtbloader that has
+ * it compiled in. The table order is kept as the device priority.
+ *
+ * The host is expected to be little-endian.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <efi.h>
+#include <efilib.h>
+
+#include "device.h"
+#include "devdb.h"
+
+static UINT8 *strings;
+static size_t strings_size;
+
+static UINT32 add_string(const CHAR16 *str)
+{
+	size_t len = 0, off = strings_size;
+
+	if (!str || !str[0])
+		return 0;
+
+	while (str[len])
+		len++;
+	len = (len + 1) * sizeof(CHAR16);
+
+	strings = realloc(strings, strings_size + len);
+	if (!strings) {
+		perror("realloc");
+		exit(1);
+	}
+
+	memcpy(strings + off, str, len);
+	strings_size += len;
+
+	return off;
+}
+
+static int compare_chids(const void *a, const void *b)
+{
+	const struct devdb_chid *x = a, *y = b;
+	int ret;
+
+	ret = memcmp(&x->chid, &y->chid, sizeof(x->chid));
+	if (ret)
+		return ret;
+
+	return x->priority < y->priority ? -1 : x->priority > y->priority;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-o devices.db]\n", name);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	struct devdb_header hdr = { .magic = DEVDB_MAGIC, .version = DEVDB_VERSION };
+	const char *output = "devices.db";
+	struct devdb_device *devices;
+	struct devdb_chid *chids;
+	struct device **dev;
+	UINT32 i = 0, n = 0, j;
+	FILE *f;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:")) != -1) {
+		switch (opt) {
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind != argc)
+		usage(argv[0]);
+
+	for_each_device(dev) {
+		hdr.device_count++;
+		for (j = 0; (*dev)->hwids[j].Data1; ++j)
+			hdr.chid_count++;
+	}
+
+	devices = calloc(hdr.device_count, sizeof(*devices));
+	chids = calloc(hdr.chid_count, sizeof(*chids));
+	if (!devices || !chids) {
+		perror("calloc");
+		return 1;
+	}
+
+	/* Offset 0 is the empty string. */
+	strings = calloc(1, sizeof(CHAR16));
+	strings_size = sizeof(CHAR16);
+
+	for_each_device(dev) {
+		bool has_code = (*dev)->rules || (*dev)->extra_match || (*dev)->prefetch || (*dev)->dt_fixup ||
+				(*dev)->dt_prune;
+
+		devices[i].name = add_string((*dev)->name);
+		devices[i].dtb = add_string((*dev)->dtb);
+		devices[i].fixup = has_code ? devices[i].name : 0;
+		devices[i].priority = i;
+
+		for (j = 0; (*dev)->hwids[j].Data1; ++j) {
+			chids[n].chid = (*dev)->hwids[j];
+			chids[n].device = i;
+			chids[n].priority = i;
+			n++;
+		}
+
+		i++;
+	}
+
+	qsort(chids, hdr.chid_count, sizeof(*chids), compare_chids);
+
+	hdr.devices = sizeof(hdr);
+	hdr.chids = hdr.devices + hdr.device_count * sizeof(*devices);
+	hdr.strings = hdr.chids + hdr.chid_count * sizeof(*chids);
+	hdr.strings_size = strings_size;
+	hdr.size = hdr.strings + strings_size;
+
+	f = fopen(output, "wb");
+	if (!f) {
+		perror(output);
+		return 1;
+	}
+
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 ||
+	    fwrite(devices, sizeof(*devices), hdr.device_count, f) != hdr.device_count ||
+	    fwrite(chids, sizeof(*chids), hdr.chid_count, f) != hdr.chid_count ||
+	    fwrite(strings, strings_size, 1, f) != 1) {
+		perror(output);
+		fclose(f);
+		return 1;
+	}
+
+	fclose(f);
+
+	printf("%s: %u devices, %u CHIDs, %u bytes\n", output, hdr.device_count, hdr.chid_count, hdr.size);
+
+	return 0;
+}
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * dtbloader-sim - Run the whole driver against a mock firmware.
+ *
+ * For every "fwupdtool hwids" dump given this runs efi_main() and then
+ * calls the DT fixup protocol like a bootloader would, reporting the time
+ * spent in every stage as well as allocations and I/O done.
+ *
+ * Each dump runs in its own process since efi_main() is only expected to
+ * run once and a broken extra_match() should not take the others down.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <efi.h>
+#include <efilib.h>
+#include <libfdt.h>
+
+#include "device.h"
+#include "timing.h"
+#include "util.h"
+#include "protocol/dt_fixup.h"
+
+#include "firmware.h"
+#include "hwids.h"
+
+EFI_STATUS efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable);
+
+#define NAME_LEN	128
+
+static void str16_to_ascii(char *out, const CHAR16 *in, size_t len)
+{
+	size_t i;
+
+	for (i = 0; in[i] && i < len - 1; ++i)
+		out[i] = in[i] < 0x80 ? in[i] : '?';
+	out[i] = '\0';
+}
+
+/**
+ * run_fixup() - Call the DT fixup protocol like sd-boot would.
+ */
+static EFI_STATUS run_fixup(void)
+{
+	EFI_GUID fixup_guid = EFI_DT_FIXUP_PROTOCOL_GUID;
+	EFI_GUID dtb_guid = EFI_DTB_TABLE_GUID;
+	EFI_DT_FIXUP_PROTOCOL *fixup;
+	EFI_STATUS status;
+	void *table, *dtb;
+	UINTN size;
+
+	status = uefi_call_wrapper(BS->LocateProtocol, 3, &fixup_guid, NULL, (void **)&fixup);
+	if (EFI_ERROR(status))
+		return status;
+
+	if (!EFI_ERROR(LibGetSystemConfigurationTable(&dtb_guid, &table))) {
+		size = fdt_totalsize(table);
+		dtb = malloc(size);
+		memcpy(dtb, table, size);
+	} else {
+		size = 4096;
+		dtb = malloc(size);
+		fdt_create_empty_tree(dtb, size);
+		size = fdt_totalsize(dtb);
+	}
+
+	status = uefi_call_wrapper(fixup->Fixup, 4, fixup, dtb, &size,
+				   EFI_DT_APPLY_FIXUPS | EFI_DT_RESERVE_MEMORY);
+	if (status == EFI_BUFFER_TOO_SMALL) {
+		dtb = realloc(dtb, size);
+		status = uefi_call_wrapper(fixup->Fixup, 4, fixup, dtb, &size,
+					   EFI_DT_APPLY_FIXUPS | EFI_DT_RESERVE_MEMORY);
+	}
+
+	free(dtb);
+	return status;
+}
+
+/**
+ * simulate() - Boot with SMBIOS from @path, runs in a child process.
+ * @esp:  Handle of the partition dtbloader is "loaded" from.
+ * @fd:   Pipe to report the matched device name to the parent.
+ */
+static int simulate(const char *path, EFI_HANDLE esp, int fd)
+{
+	char name[NAME_LEN] = "";
+	EFI_STATUS status, fixup_status = EFI_NOT_STARTED;
+	struct device *dev;
+	struct hwids hw;
+	UINT64 start, ns;
+	int i;
+
+	if (hwids_parse(path, &hw)) {
+		fprintf(stderr, "%s: failed to parse\n", path);
+		return 1;
+	}
+
+	hwids_install_smbios(&hw);
+
+	start = host_time_ns();
+	status = efi_main(host_new_image(esp), host_efi_init());
+	if (!EFI_ERROR(status))
+		fixup_status = run_fixup();
+	ns = host_time_ns() - start;
+
+	dev = match_device();
+	if (dev)
+		str16_to_ascii(name, dev->name, sizeof(name));
+
+	if (write(fd, name, strlen(name)) < 0)
+		perror("write");
+
+	printf("%s: device=\"%s\" status=0x%lx fixup=0x%lx total=%llu",
+	       path, dev ? name : "", (unsigned long)status, (unsigned long)fixup_status,
+	       (unsigned long long)ns / 1000);
+
+	for (i = 0; i < timing_count; ++i) {
+		struct timing_stage *s = &timing_stages[i];
+		char stage[32];
+
+		str16_to_ascii(stage, s->name, sizeof(stage));
+		printf(" %s=%llu", stage, (unsigned long long)(s->end ? timer_us(s->end - s->start) : 0));
+	}
+
+	printf(" pool=%lu pages=%lu files=%lu reads=%lu bytes=%lu disk_reads=%lu disk_bytes=%lu vars=%lu/%lu\n",
+	       host_stats.pool_allocs, host_stats.page_allocs,
+	       host_stats.file_opens, host_stats.file_reads, host_stats.file_read_bytes,
+	       host_stats.disk_reads, host_stats.disk_read_bytes,
+	       host_stats.var_reads, host_stats.var_writes);
+
+	hwids_free(&hw);
+	return EFI_ERROR(status) || EFI_ERROR(fixup_status);
+}
+
+static int run_one(const char *path, EFI_HANDLE esp, char *name)
+{
+	int pipefd[2], wstatus;
+	ssize_t len;
+	pid_t pid;
+
+	if (pipe(pipefd)) {
+		perror("pipe");
+		return 1;
+	}
+
+	fflush(stdout);
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return 1;
+	}
+
+	if (!pid) {
+		close(pipefd[0]);
+		exit(simulate(path, esp, pipefd[1]));
+	}
+
+	close(pipefd[1]);
+	len = read(pipefd[0], name, NAME_LEN - 1);
+	name[len > 0 ? len : 0] = '\0';
+	close(pipefd[0]);
+
+	waitpid(pid, &wstatus, 0);
+
+	if (WIFSIGNALED(wstatus)) {
+		printf("%s: crashed with signal %d\n", path, WTERMSIG(wstatus));
+		return 1;
+	}
+
+	return WEXITSTATUS(wstatus);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-e ESP_DIR] [-d DISK_IMAGE]... [-V VARS_FILE] [-v] HWIDS_FILE...\n", name);
+	fprintf(stderr, "Run dtbloader for every fwupdtool hwids dump and report the boot cost.\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *esp_dir = ".";
+	char (*matched)[NAME_LEN];
+	struct device **dev;
+	int opt, i, fails = 0;
+	bool verbose = false;
+	EFI_HANDLE esp;
+
+	InitializeLib(NULL, host_efi_init());
+
+	while ((opt = getopt(argc, argv, "e:d:V:vh")) != -1) {
+		switch (opt) {
+		case 'e':
+			esp_dir = optarg;
+			break;
+		case 'd':
+			if (host_disk_add(optarg) < 0) {
+				fprintf(stderr, "%s: can't open disk image\n", optarg);
+				return 1;
+			}
+			break;
+		case 'V':
+			if (host_vars_load(optarg)) {
+				fprintf(stderr, "%s: can't load variables\n", optarg);
+				return 1;
+			}
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	host_quiet = !verbose;
+	esp = host_esp_init(esp_dir);
+
+	matched = calloc(argc - optind, sizeof(*matched));
+
+	for (i = 0; optind + i < argc; ++i)
+		fails += run_one(argv[optind + i], esp, matched[i]);
+
+	/* Point out the devices no dump has reached. */
+	for_each_device(dev) {
+		char name[NAME_LEN];
+		bool found = false;
+
+		str16_to_ascii(name, (*dev)->name, sizeof(name));
+
+		for (i = 0; optind + i < argc; ++i)
+			found |= !strcmp(name, matched[i]);
+
+		if (!found)
+			printf("not covered: %s\n", name);
+	}
+
+	if (fails)
+		printf("%d file(s) failed\n", fails);
+
+	free(matched);
+	return !!fails;
+}
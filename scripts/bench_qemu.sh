@@ -0,0 +1,106 @@
+#!/bin/bash
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Boot a TIMING=1 build of dtbloader in QEMU once for every device in
+# scripts/hwids with its SMBIOS and collect the stage timings it logs.
+#
+# Usage: bench_qemu.sh [-o results.json] [hwids files...]
+#
+# BENCH_DIR and BENCH_MAKE_ARGS select the build directory and extra make
+# variables, i.e. to compare PGO and regular builds. BENCH_SOC runs the
+# per-SoC image for that SoC instead of the full one.
+#
+# The JSON output is stable (one device per line, sorted by file name)
+# so results of two builds can be compared with diff.
+
+set -e
+
+BASEDIR="$(realpath "$(dirname "$0")/..")"
+export BUILDDIR="${BENCH_DIR:-$BASEDIR/build-bench}"
+OUTPUT="bench.json"
+
+if [ "$1" = "-o" ]
+then
+	OUTPUT="$2"
+	shift 2
+fi
+
+if [ $# -eq 0 ]
+then
+	set -- "$BASEDIR"/scripts/hwids/*.txt
+fi
+
+if ! command -v dtc > /dev/null
+then
+	echo "dtc is needed to create dummy DTBs" >&2
+	exit 1
+fi
+
+if [ -n "$BENCH_SOC" ]
+then
+	export IMAGE="dtbloader-$BENCH_SOC.efi"
+fi
+
+make -C "$BASEDIR" -j"$(nproc)" O="$BUILDDIR" TIMING=1 $BENCH_MAKE_ARGS "$BUILDDIR/${IMAGE:-dtbloader.efi}" > /dev/null
+
+# A tiny DTB for every supported device, named after it so it's clear which one was loaded.
+"$BASEDIR"/scripts/get_supported_dtbs.sh | while read -r dtb
+do
+	mkdir -p "$(dirname "$BUILDDIR/dtbloader/dtbs/$dtb")"
+	echo "/dts-v1/; / { model = \"$dtb\"; };" \
+		| dtc -I dts -O dtb -o "$BUILDDIR/dtbloader/dtbs/$dtb" -
+done
+
+# Get a value from a "fwupdtool hwids" dump, escaping commas for qemu.
+hwids_field() {
+	sed -n "s/^$2: //p" "$1" | tr -d '\r' | sed 's/,/,,/g'
+}
+
+smbios_args() {
+	local file="$1"
+
+	printf '%s\n' -smbios "type=1,manufacturer=$(hwids_field "$file" Manufacturer),product=$(hwids_field "$file" ProductName),sku=$(hwids_field "$file" ProductSku),family=$(hwids_field "$file" Family)"
+	printf '%s\n' -smbios "type=2,manufacturer=$(hwids_field "$file" BaseboardManufacturer),product=$(hwids_field "$file" BaseboardProduct)"
+}
+
+json_escape() {
+	sed -e 's/\\/\\\\/g' -e 's/"/\\"/g'
+}
+
+echo "[" > "$OUTPUT"
+first=1
+
+printf "%-44s %-40s %s\n" "HWIDS" "DEVICE" "STAGES (us)"
+
+for file in "$@"
+do
+	name="$(basename "$file" .txt)"
+	mapfile -t args < <(smbios_args "$file")
+
+	log="$("$BASEDIR"/scripts/run_qemu.sh smbios "${args[@]}" 2>&1 | tr -d '\r')"
+
+	device="$(sed -n 's/^Detected device: //p' <<< "$log" | head -n 1)"
+	stages="$(sed -n 's/^Stage \([^:]*\): +[0-9]* us, \([0-9]*\) us$/\1=\2/p' <<< "$log" | tr '\n' ' ')"
+
+	if [ -z "$device" ]
+	then
+		grep -q "Failed to detect" <<< "$log" && device="(none)" || device="(no output)"
+	fi
+
+	printf "%-44s %-40s %s\n" "$name" "$device" "$stages"
+
+	json_stages=""
+	for s in $stages
+	do
+		json_stages+="${json_stages:+, }\"${s%%=*}\": ${s##*=}"
+	done
+
+	[ $first -eq 1 ] || echo "," >> "$OUTPUT"
+	first=0
+	printf '  {"hwids": "%s", "device": "%s", "stages_us": {%s}}' \
+		"$name" "$(json_escape <<< "$device")" "$json_stages" >> "$OUTPUT"
+done
+
+printf "\n]\n" >> "$OUTPUT"
+
+echo "Results saved to $OUTPUT"
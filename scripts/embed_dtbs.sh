@@ -0,0 +1,77 @@
+#!/bin/bash
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Generate a C file with LZ4-compressed copies of every DTB from DIR that
+# is used by some device, for "make EMBED_DTBS=DIR", see src/embedded.c
+#
+# Usage: embed_dtbs.sh DIR OUTPUT.c [DEVICE.c...]
+#
+# Only the DTBs of the given device descriptions are embedded, all of
+# src/devices by default. Per-SoC images pass just their own devices.
+#
+# DTBs are looked up by their path from the device description and then by
+# the file name alone, same as on the ESP.
+
+set -e
+
+BASEDIR="$(realpath "$(dirname "$0")/..")"
+DIR="$1"
+OUTPUT="$2"
+shift 2
+
+if [ $# -eq 0 ]
+then
+	set -- "$BASEDIR"/src/devices/*.c
+fi
+
+if ! command -v lz4 > /dev/null
+then
+	echo "lz4 is needed to compress DTBs" >&2
+	exit 1
+fi
+
+tmp="$(mktemp)"
+trap 'rm -f "$tmp" "$tmp.idx"' EXIT
+
+{
+	echo "/* Generated by scripts/embed_dtbs.sh, do not edit. */"
+	echo
+	echo "#include <embedded.h>"
+	echo
+	echo "#pragma section(\".dtbs\", read)"
+	echo
+} > "$OUTPUT"
+
+n=0
+: > "$tmp.idx"
+
+# All DTB names used by devices, including tentative ones.
+grep -h -E ".dtb +=" "$@" \
+	| sed -e 's/.*L"\(.*\)",.*/\1/' -e 's_\\\\_/_g' \
+	| sort -u \
+	| while read -r dtb
+do
+	file="$DIR/$dtb"
+	[ -e "$file" ] || file="$DIR/$(basename "$dtb")"
+	[ -e "$file" ] || continue
+
+	lz4 -q -l -9 -c "$file" > "$tmp"
+
+	echo "__declspec(allocate(\".dtbs\")) static const UINT8 dtb_$n[] = {" >> "$OUTPUT"
+	od -An -v -tx1 "$tmp" | sed -e 's/ \([0-9a-f][0-9a-f]\)/0x\1,/g' -e 's/^/\t/' >> "$OUTPUT"
+	echo "};" >> "$OUTPUT"
+	echo >> "$OUTPUT"
+
+	printf '\t{ L"%s", dtb_%d, sizeof(dtb_%d), %d },\n' \
+		"${dtb//\//\\\\}" "$n" "$n" "$(stat -c %s "$file")" >> "$tmp.idx"
+
+	echo "Embedded $dtb: $(stat -c %s "$file") -> $(stat -c %s "$tmp") bytes" >&2
+	n=$((n + 1))
+done
+
+{
+	echo "const struct embedded_dtb embedded_dtbs[] = {"
+	cat "$tmp.idx"
+	echo "	{ 0 }"
+	echo "};"
+} >> "$OUTPUT"
@@ -0,0 +1,72 @@
+#!/bin/bash
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Collect a PGO profile by booting an instrumented dtbloader in QEMU for
+# every device in scripts/hwids, then compare stage timings of a regular
+# and a profile-optimized build.
+#
+# The profile is taken from a release build, since a profile only fits
+# builds with the same flags. The timed builds only add TIMING=1, which
+# doesn't touch the profiled code, see the Makefile.
+#
+# Usage: pgo_train.sh [output.profdata]
+#
+# Afterwards build with: make PGO=dtbloader.profdata
+
+set -e
+
+BASEDIR="$(realpath "$(dirname "$0")/..")"
+PROFDATA="$(realpath -m "${1:-$BASEDIR/dtbloader.profdata}")"
+export BUILDDIR="$BASEDIR/build-pgo-gen"
+
+make -C "$BASEDIR" -j"$(nproc)" O="$BUILDDIR" PGO_GEN=1 > /dev/null
+
+rm -rf "$BUILDDIR/profiles"
+mkdir -p "$BUILDDIR/profiles"
+
+hwids_field() {
+	sed -n "s/^$2: //p" "$1" | tr -d '\r' | sed 's/,/,,/g'
+}
+
+for file in "$BASEDIR"/scripts/hwids/*.txt
+do
+	name="$(basename "$file" .txt)"
+	rm -f "$BUILDDIR/dtbloader.profraw"
+
+	"$BASEDIR"/scripts/run_qemu.sh smbios \
+		-smbios "type=1,manufacturer=$(hwids_field "$file" Manufacturer),product=$(hwids_field "$file" ProductName),sku=$(hwids_field "$file" ProductSku),family=$(hwids_field "$file" Family)" \
+		-smbios "type=2,manufacturer=$(hwids_field "$file" BaseboardManufacturer),product=$(hwids_field "$file" BaseboardProduct)" \
+		> /dev/null 2>&1 || true
+
+	if [ -e "$BUILDDIR/dtbloader.profraw" ]
+	then
+		mv "$BUILDDIR/dtbloader.profraw" "$BUILDDIR/profiles/$name.profraw"
+		echo "Collected $name"
+	else
+		echo "No profile from $name" >&2
+	fi
+done
+
+llvm-profdata merge -o "$PROFDATA" "$BUILDDIR"/profiles/*.profraw
+echo "Profile saved to $PROFDATA"
+
+BENCH_DIR="$BASEDIR/build-bench" \
+	"$BASEDIR"/scripts/bench_qemu.sh -o "$BASEDIR/bench-base.json" > /dev/null
+BENCH_DIR="$BASEDIR/build-bench-pgo" BENCH_MAKE_ARGS="PGO=$PROFDATA" \
+	"$BASEDIR"/scripts/bench_qemu.sh -o "$BASEDIR/bench-pgo.json" > /dev/null
+
+# Sum all stages of every device from both runs.
+total_us() {
+	sed -n 's/.*"hwids": "\([^"]*\)".*"stages_us": {\(.*\)}}.*/\1 \2/p' "$1" \
+		| awk '{ t = 0; for (i = 3; i <= NF; i += 2) { v = $i; sub(",", "", v); t += v } print $1, t }'
+}
+
+printf "%-44s %10s %10s %8s\n" "HWIDS" "BASE (us)" "PGO (us)" "CHANGE"
+join <(total_us "$BASEDIR/bench-base.json" | sort) <(total_us "$BASEDIR/bench-pgo.json" | sort) \
+	| awk '{
+		printf "%-44s %10d %10d %7.1f%%\n", $1, $2, $3, $2 ? 100 * ($3 - $2) / $2 : 0
+		base += $2; pgo += $3
+	}
+	END {
+		printf "%-44s %10d %10d %7.1f%%\n", "total", base, pgo, base ? 100 * (pgo - base) / base : 0
+	}'
@@ -0,0 +1,105 @@
+#!/bin/bash
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Count instructions executed by dtbloader under QEMU TCG and print a flat
+# profile per function. Unlike wall clock time in an emulator this is
+# deterministic, so it's good for comparing hot paths between builds.
+#
+# Usage: profile_qemu.sh [hwids file]
+#
+# QEMU_PLUGIN_INC may point to the directory with qemu-plugin.h.
+
+set -e
+
+BASEDIR="$(realpath "$(dirname "$0")/..")"
+export BUILDDIR="$BASEDIR/build-profile"
+HWIDS="${1:-$BASEDIR/scripts/hwids/msm8998-lenovo-miix-630-81f1.txt}"
+TOP="${TOP:-40}"
+
+# The image base is only logged by debug builds.
+make -C "$BASEDIR" -j"$(nproc)" O="$BUILDDIR" DEBUG=1 > /dev/null
+
+cc -shared -fPIC -O2 \
+	${QEMU_PLUGIN_INC:+-I"$QEMU_PLUGIN_INC"} \
+	$(pkg-config --cflags glib-2.0) \
+	"$BASEDIR/scripts/qemu_insn_count.c" \
+	-o "$BUILDDIR/insn_count.so"
+
+# Same SMBIOS conversion as bench_qemu.sh
+hwids_field() {
+	sed -n "s/^$2: //p" "$HWIDS" | tr -d '\r' | sed 's/,/,,/g'
+}
+
+export QEMU_TIMEOUT=300s
+export QEMU_EXTRA_ARGS="-accel tcg -plugin $BUILDDIR/insn_count.so,out=$BUILDDIR/insns.txt"
+
+"$BASEDIR"/scripts/run_qemu.sh smbios \
+	-smbios "type=1,manufacturer=$(hwids_field Manufacturer),product=$(hwids_field ProductName),sku=$(hwids_field ProductSku),family=$(hwids_field Family)" \
+	-smbios "type=2,manufacturer=$(hwids_field BaseboardManufacturer),product=$(hwids_field BaseboardProduct)" \
+	| tr -d '\r' > "$BUILDDIR/profile.log"
+
+load_base="$(sed -n 's/^Image base: \(0x[0-9a-fA-F]*\).*/\1/p' "$BUILDDIR/profile.log" | head -n 1)"
+if [ -z "$load_base" ]
+then
+	echo "dtbloader didn't log its image base, see $BUILDDIR/profile.log" >&2
+	exit 1
+fi
+
+# Preferred base and size of the image from the PE32+ optional header.
+pe_u32() { od -An -tu4 -j "$1" -N4 "$BUILDDIR/dtbloader.efi" | tr -d ' '; }
+pe_u64() { od -An -tu8 -j "$1" -N8 "$BUILDDIR/dtbloader.efi" | tr -d ' '; }
+
+opt_hdr=$(( $(pe_u32 60) + 24 ))
+pe_base=$(pe_u64 $(( opt_hdr + 24 )))
+pe_size=$(pe_u32 $(( opt_hdr + 56 )))
+
+# Sum counts per address within the image and rebase them to the preferred base.
+gawk -v load=$((load_base)) -v size="$pe_size" -v base="$pe_base" '
+	{
+		addr = strtonum("0x" $1)
+		if (addr < load || addr >= load + size) {
+			outside += $2
+			next
+		}
+		count[addr - load + base] += $2
+	}
+	END {
+		for (a in count)
+			printf "0x%x %d\n", a, count[a]
+		printf "outside %d\n", outside > "/dev/stderr"
+	}
+' "$BUILDDIR/insns.txt" 2> "$BUILDDIR/outside.txt" | sort > "$BUILDDIR/counts.txt"
+
+cut -d' ' -f1 "$BUILDDIR/counts.txt" \
+	| llvm-symbolizer --obj="$BUILDDIR/dtbloader.efi" \
+		--functions=linkage --no-inlines --output-style=GNU \
+	| paste - - \
+	| paste -d'\t' - <(cut -d' ' -f2 "$BUILDDIR/counts.txt") \
+	| awk -F'\t' '
+		{
+			file = $2
+			sub(/:[0-9]+.*$/, "", file)
+			n = split(file, parts, "/")
+			if (file ~ /libfdt/)
+				file = "libfdt/" parts[n]
+			else if (file ~ /gnu-efi/)
+				file = "gnu-efi/" parts[n]
+			else
+				file = parts[n]
+
+			insns[$1 "\t" file] += $3
+			total += $3
+		}
+		END {
+			for (k in insns) {
+				split(k, f, "\t")
+				printf "%7.2f %12d  %-40s %s\n", 100 * insns[k] / total, insns[k], f[1], f[2]
+			}
+		}
+	' > "$BUILDDIR/profile.txt"
+
+printf "%7s %12s  %-40s %s\n" "%" "INSNS" "FUNCTION" "FILE"
+sort -k2 -n -r "$BUILDDIR/profile.txt" | head -n "$TOP"
+
+echo
+echo "Instructions executed outside of dtbloader: $(cut -d' ' -f2 "$BUILDDIR/outside.txt")"
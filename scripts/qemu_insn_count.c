@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * QEMU TCG plugin that counts how many times every guest instruction ran.
+ *
+ * On exit it writes "vaddr count" lines for every executed instruction
+ * into the file passed as "out=" (insns.txt by default). The same address
+ * may appear more than once if its block was translated differently, the
+ * counts should be summed. See profile_qemu.sh.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <qemu-plugin.h>
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+struct tb_entry {
+	uint64_t count;
+	size_t n_insns;
+	uint64_t vaddr[];
+};
+
+static GHashTable *tbs;
+static GPtrArray *all_tbs;
+static GMutex lock;
+static const char *out_path = "insns.txt";
+
+static void tb_exec(unsigned int vcpu, void *udata)
+{
+	struct tb_entry *e = udata;
+
+	__atomic_fetch_add(&e->count, 1, __ATOMIC_RELAXED);
+}
+
+static void tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+	uint64_t start = qemu_plugin_tb_vaddr(tb);
+	size_t n = qemu_plugin_tb_n_insns(tb);
+	struct tb_entry *e;
+	size_t i;
+
+	g_mutex_lock(&lock);
+
+	e = g_hash_table_lookup(tbs, &start);
+	if (!e || e->n_insns != n) {
+		e = g_malloc0(sizeof(*e) + n * sizeof(e->vaddr[0]));
+		e->n_insns = n;
+		for (i = 0; i < n; ++i)
+			e->vaddr[i] = qemu_plugin_insn_vaddr(qemu_plugin_tb_get_insn(tb, i));
+
+		g_ptr_array_add(all_tbs, e);
+		g_hash_table_insert(tbs, &e->vaddr[0], e);
+	}
+
+	g_mutex_unlock(&lock);
+
+	qemu_plugin_register_vcpu_tb_exec_cb(tb, tb_exec, QEMU_PLUGIN_CB_NO_REGS, e);
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+	FILE *f = fopen(out_path, "w");
+	size_t i, j;
+
+	if (!f) {
+		perror(out_path);
+		return;
+	}
+
+	for (i = 0; i < all_tbs->len; ++i) {
+		struct tb_entry *e = g_ptr_array_index(all_tbs, i);
+
+		if (!e->count)
+			continue;
+
+		for (j = 0; j < e->n_insns; ++j)
+			fprintf(f, "%" PRIx64 " %" PRIu64 "\n", e->vaddr[j], e->count);
+	}
+
+	fclose(f);
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+					   int argc, char **argv)
+{
+	int i;
+
+	for (i = 0; i < argc; ++i) {
+		if (g_str_has_prefix(argv[i], "out="))
+			out_path = g_strdup(argv[i] + 4);
+	}
+
+	tbs = g_hash_table_new(g_int64_hash, g_int64_equal);
+	all_tbs = g_ptr_array_new();
+
+	qemu_plugin_register_vcpu_tb_trans_cb(id, tb_trans);
+	qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+
+	return 0;
+}
@@ -1,13 +1,14 @@
 #!/bin/bash
 
 BASEDIR="$(dirname "$0")/../"
-BUILDDIR="$BASEDIR/build-aarch64"
+BUILDDIR="${BUILDDIR:-$BASEDIR/build-aarch64}"
+IMAGE="${IMAGE:-dtbloader.efi}"
 
 cat << EOF > "$BUILDDIR/startup.nsh"
 @echo -off
 fs0:
 echo =====================================
-load dtbloader.efi
+load $IMAGE
 echo =====================================
 reset -s
 EOF
@@ -33,19 +34,27 @@ then
 		miix)
 			# default
 			;;
+		smbios)
+			# Rest of the args are -smbios options, see bench_qemu.sh
+			shift
+			QEMU_SMBIOS_ARGS=("$@")
+			;;
 	esac
 fi
 
+# QEMU_EXTRA_ARGS is split on spaces on purpose, i.e. for -plugin args.
 timeout --foreground \
 	--kill-after=120s \
-	30s \
+	"${QEMU_TIMEOUT:-30s}" \
 	qemu-system-aarch64 \
 		-machine virt \
 		-cpu cortex-a53 \
+		-smp 4 \
 		-m 512 \
 		-bios "/usr/share/AAVMF/AAVMF_CODE.fd" \
 		-drive if=virtio,format=raw,file=fat:rw:"$BUILDDIR" \
 		"${QEMU_SMBIOS_ARGS[@]}" \
+		$QEMU_EXTRA_ARGS \
 		-nographic -no-reboot \
 			| sed \
 				-e 's/\x1b\[[0-9]\+;01H/\n/g' \
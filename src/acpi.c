@@ -0,0 +1,359 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Indexed ACPI table access.
+ *
+ * The XSDT is walked once, on first use, and every table it points to
+ * (plus the DSDT from the FADT) is recorded by signature. This lets the
+ * extra_match callbacks look up variant data from the firmware tables
+ * instead of hardcoding addresses that happen to be right on one
+ * firmware version.
+ *
+ * OperationRegion lookups do a plain byte scan of the DSDT and SSDTs for
+ * the DefOpRegion opcode instead of parsing AML: only regions with a
+ * constant offset and length are reported, which is what the firmware
+ * uses for the NVS areas we care about. Scans are bounded by the table
+ * lengths and their results (including misses) are cached.
+ */
+
+#include <stdbool.h>
+#include <efi.h>
+#include <efilib.h>
+
+#include <util.h>
+#include <acpi.h>
+
+#define ACPI_MAX_TABLES		64
+#define ACPI_MAX_REGIONS	8
+#define ACPI_MAX_TABLE_SIZE	(16 * 1024 * 1024)
+
+#define AML_ZERO_OP		0x00
+#define AML_ONE_OP		0x01
+#define AML_BYTE_PREFIX		0x0a
+#define AML_WORD_PREFIX		0x0b
+#define AML_DWORD_PREFIX	0x0c
+#define AML_QWORD_PREFIX	0x0e
+#define AML_DUAL_NAME_PREFIX	0x2e
+#define AML_MULTI_NAME_PREFIX	0x2f
+#define AML_EXT_OP_PREFIX	0x5b
+#define AML_ROOT_CHAR		'\\'
+#define AML_PARENT_PREFIX_CHAR	'^'
+#define AML_ONES_OP		0xff
+#define AML_EXT_REGION_OP	0x80
+
+#pragma pack(1)
+typedef struct {
+	CHAR8  Signature[8];
+	UINT8  Checksum;
+	CHAR8  OemId[6];
+	UINT8  Revision;
+	UINT32 RsdtAddress;
+	UINT32 Length;
+	UINT64 XsdtAddress;
+	UINT8  ExtendedChecksum;
+	UINT8  Reserved[3];
+} ACPI_RSDP;
+#pragma pack()
+
+#define FADT_DSDT_OFFSET	40
+#define FADT_X_DSDT_OFFSET	140
+
+/**
+ * struct acpi_region - Cached OperationRegion lookup.
+ * @name:    NameSeg of the region.
+ * @space:   Requested region space.
+ * @status:  Result of the lookup.
+ * @base:    Region offset.
+ * @len:     Region length.
+ */
+struct acpi_region {
+	CHAR8 name[4];
+	UINT8 space;
+	EFI_STATUS status;
+	UINT64 base;
+	UINT64 len;
+};
+
+static struct {
+	bool init;
+	ACPI_SDT_HEADER *tables[ACPI_MAX_TABLES];
+	UINTN table_count;
+	struct acpi_region regions[ACPI_MAX_REGIONS];
+	UINTN region_count;
+} acpi;
+
+static void acpi_add_table(ACPI_SDT_HEADER *hdr)
+{
+	if (!hdr || acpi.table_count == ACPI_MAX_TABLES)
+		return;
+
+	if (hdr->Length < sizeof(*hdr) || hdr->Length > ACPI_MAX_TABLE_SIZE)
+		return;
+
+	acpi.tables[acpi.table_count++] = hdr;
+}
+
+static void acpi_init(void)
+{
+	EFI_GUID acpi20_guid = ACPI_20_TABLE_GUID;
+	ACPI_RSDP *rsdp = NULL;
+	ACPI_SDT_HEADER *xsdt, *fadt;
+	UINT64 addr;
+	UINTN i, count;
+
+	acpi.init = true;
+
+	if (EFI_ERROR(LibGetSystemConfigurationTable(&acpi20_guid, (VOID **)&rsdp)))
+		return;
+
+	if (rsdp->Revision < 2 || !rsdp->XsdtAddress)
+		return;
+
+	xsdt = (ACPI_SDT_HEADER *)(UINTN)rsdp->XsdtAddress;
+	if (CompareMem(xsdt->Signature, "XSDT", 4) || xsdt->Length < sizeof(*xsdt))
+		return;
+
+	count = (xsdt->Length - sizeof(*xsdt)) / sizeof(UINT64);
+
+	for (i = 0; i < count; ++i) {
+		/* The entries are only 4-byte aligned. */
+		CopyMem(&addr, (UINT8 *)(xsdt + 1) + i * sizeof(addr), sizeof(addr));
+		acpi_add_table((ACPI_SDT_HEADER *)(UINTN)addr);
+	}
+
+	/* The DSDT isn't listed in the XSDT, only referenced by the FADT. */
+	fadt = acpi_find_table("FACP", 0);
+	if (!fadt)
+		return;
+
+	addr = 0;
+	if (fadt->Length >= FADT_X_DSDT_OFFSET + sizeof(UINT64))
+		CopyMem(&addr, (UINT8 *)fadt + FADT_X_DSDT_OFFSET, sizeof(UINT64));
+	if (!addr && fadt->Length >= FADT_DSDT_OFFSET + sizeof(UINT32))
+		CopyMem(&addr, (UINT8 *)fadt + FADT_DSDT_OFFSET, sizeof(UINT32));
+
+	acpi_add_table((ACPI_SDT_HEADER *)(UINTN)addr);
+
+	Dbg(L"ACPI: indexed %d tables\n", acpi.table_count);
+}
+
+/**
+ * acpi_find_table() - Find an ACPI table by signature.
+ * @signature:  Four character table signature, i.e. "DSDT".
+ * @instance:   Which of the tables with this signature to return.
+ *
+ * Returns: Pointer to the table header or NULL if there is no such table.
+ */
+ACPI_SDT_HEADER *acpi_find_table(const char *signature, UINTN instance)
+{
+	UINTN i;
+
+	if (!acpi.init)
+		acpi_init();
+
+	for (i = 0; i < acpi.table_count; ++i) {
+		if (CompareMem(acpi.tables[i]->Signature, signature, 4))
+			continue;
+
+		if (!instance--)
+			return acpi.tables[i];
+	}
+
+	return NULL;
+}
+
+static bool aml_name_char(UINT8 c, bool lead)
+{
+	if ((c >= 'A' && c <= 'Z') || c == '_')
+		return true;
+
+	return !lead && c >= '0' && c <= '9';
+}
+
+/**
+ * aml_name_string() - Skip a NameString.
+ * @p:    Start of the NameString.
+ * @end:  End of the table.
+ * @seg:  Set to the last NameSeg of the path.
+ *
+ * Returns: Pointer past the NameString or NULL if it's not a valid one.
+ */
+static UINT8 *aml_name_string(UINT8 *p, UINT8 *end, UINT8 **seg)
+{
+	UINTN count = 1, i, j;
+
+	if (p < end && *p == AML_ROOT_CHAR)
+		p++;
+	else
+		while (p < end && *p == AML_PARENT_PREFIX_CHAR)
+			p++;
+
+	if (p >= end)
+		return NULL;
+
+	if (*p == AML_DUAL_NAME_PREFIX) {
+		count = 2;
+		p++;
+	} else if (*p == AML_MULTI_NAME_PREFIX) {
+		if (end - p < 2)
+			return NULL;
+		count = p[1];
+		p += 2;
+	}
+
+	if (!count || (UINTN)(end - p) < count * 4)
+		return NULL;
+
+	for (i = 0; i < count; ++i)
+		for (j = 0; j < 4; ++j)
+			if (!aml_name_char(p[i * 4 + j], j == 0))
+				return NULL;
+
+	*seg = p + (count - 1) * 4;
+
+	return p + count * 4;
+}
+
+/**
+ * aml_integer() - Decode a constant integer TermArg.
+ * @p:    Start of the TermArg.
+ * @end:  End of the table.
+ * @val:  Decoded value.
+ *
+ * Returns: Pointer past the integer or NULL if the TermArg isn't a constant.
+ */
+static UINT8 *aml_integer(UINT8 *p, UINT8 *end, UINT64 *val)
+{
+	UINTN size;
+
+	if (p >= end)
+		return NULL;
+
+	switch (*p) {
+	case AML_ZERO_OP:
+		*val = 0;
+		return p + 1;
+	case AML_ONE_OP:
+		*val = 1;
+		return p + 1;
+	case AML_ONES_OP:
+		*val = ~0ULL;
+		return p + 1;
+	case AML_BYTE_PREFIX:
+		size = 1;
+		break;
+	case AML_WORD_PREFIX:
+		size = 2;
+		break;
+	case AML_DWORD_PREFIX:
+		size = 4;
+		break;
+	case AML_QWORD_PREFIX:
+		size = 8;
+		break;
+	default:
+		return NULL;
+	}
+
+	if ((UINTN)(end - p) <= size)
+		return NULL;
+
+	*val = 0;
+	CopyMem(val, p + 1, size); /* AML is little-endian, as are we. */
+
+	return p + 1 + size;
+}
+
+/**
+ * acpi_scan_opregion() - Scan one definition block for an OperationRegion.
+ */
+static bool acpi_scan_opregion(ACPI_SDT_HEADER *hdr, struct acpi_region *region)
+{
+	UINT8 *p = (UINT8 *)(hdr + 1);
+	UINT8 *end = (UINT8 *)hdr + hdr->Length;
+	UINT8 *seg, *next;
+	UINT8 space;
+
+	for (; end - p > 2; ++p) {
+		if (p[0] != AML_EXT_OP_PREFIX || p[1] != AML_EXT_REGION_OP)
+			continue;
+
+		next = aml_name_string(p + 2, end, &seg);
+		if (!next || CompareMem(seg, region->name, 4) || next >= end)
+			continue;
+
+		space = *next++;
+		if (region->space != ACPI_REGION_ANY && space != region->space)
+			continue;
+
+		next = aml_integer(next, end, &region->base);
+		if (!next || !aml_integer(next, end, &region->len))
+			continue;
+
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * acpi_find_opregion() - Find a constant OperationRegion in the DSDT or SSDTs.
+ * @name:   NameSeg of the region, i.e. "MNVS".
+ * @space:  Region space to match, or ACPI_REGION_ANY.
+ * @base:   Region offset.
+ * @len:    Region length.
+ *
+ * Only the last segment of the region path is compared, so the first
+ * region with this name in any scope is returned.
+ *
+ * Returns: EFI_SUCCESS or EFI_NOT_FOUND.
+ */
+EFI_STATUS acpi_find_opregion(const char *name, UINT8 space, UINT64 *base, UINT64 *len)
+{
+	struct acpi_region tmp = { 0 }, *region = &tmp;
+	ACPI_SDT_HEADER *hdr;
+	UINTN i;
+
+	for (i = 0; i < acpi.region_count; ++i) {
+		region = &acpi.regions[i];
+		if (!CompareMem(region->name, name, 4) && region->space == space)
+			goto out;
+	}
+
+	if (acpi.region_count < ACPI_MAX_REGIONS)
+		region = &acpi.regions[acpi.region_count++];
+	else
+		region = &tmp;
+
+	CopyMem(region->name, name, 4);
+	region->space = space;
+	region->status = EFI_NOT_FOUND;
+
+	/* The DSDT may be missing, the SSDTs still get scanned then. */
+	hdr = acpi_find_table("DSDT", 0);
+	if (hdr && acpi_scan_opregion(hdr, region))
+		region->status = EFI_SUCCESS;
+
+	for (i = 0; EFI_ERROR(region->status) && (hdr = acpi_find_table("SSDT", i)); ++i)
+		if (acpi_scan_opregion(hdr, region))
+			region->status = EFI_SUCCESS;
+
+	Dbg(L"ACPI: OperationRegion %a: %r (0x%lx, 0x%lx)\n", name,
+	    region->status, region->base, region->len);
+
+out:
+	if (!EFI_ERROR(region->status)) {
+		*base = region->base;
+		*len = region->len;
+	}
+
+	return region->status;
+}
+
+/**
+ * acpi_reset() - Forget the table index and the cached OperationRegions.
+ */
+void acpi_reset(void)
+{
+	ZeroMem(&acpi, sizeof(acpi));
+}
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Arena for transient allocations.
+ *
+ * Pool allocations are slow and take a lock in some firmware, and pairing
+ * every one of them with a FreePool() on each error path is easy to get
+ * wrong. Short-lived buffers (variables, handle lists, file info...) are
+ * instead bumped out of a few pages that are all given back at once when
+ * efi_main() or a Fixup() call is done.
+ *
+ * Memory from the arena is zeroed and 16-byte aligned. Nothing returned by
+ * it may be kept past arena_release().
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <util.h>
+#include <arena.h>
+
+#define ARENA_ALIGN	16
+
+/**
+ * struct arena_chunk - Pages the arena allocates from.
+ * @next:   Previously filled chunk.
+ * @pages:  Size of the chunk, including this header.
+ * @used:   Bytes used after the header.
+ */
+struct arena_chunk {
+	struct arena_chunk *next;
+	UINTN pages;
+	UINTN used;
+	UINT8 data[] __attribute__((aligned(ARENA_ALIGN)));
+};
+
+static struct arena_chunk *arena;
+
+static struct {
+	UINTN allocs;
+	UINTN used;
+	UINTN peak;
+	UINTN chunks;
+} arena_stats;
+
+static struct arena_chunk *arena_grow(UINTN size)
+{
+	struct arena_chunk *chunk;
+	EFI_PHYSICAL_ADDRESS addr;
+	UINTN pages;
+
+	pages = EFI_SIZE_TO_PAGES(sizeof(*chunk) + size);
+	if (pages < ARENA_CHUNK_PAGES)
+		pages = ARENA_CHUNK_PAGES;
+
+	if (EFI_ERROR(AllocateZeroPages(pages, &addr)))
+		return NULL;
+
+	chunk = (struct arena_chunk *)addr;
+	chunk->next = arena;
+	chunk->pages = pages;
+	arena = chunk;
+
+	arena_stats.chunks++;
+
+	return chunk;
+}
+
+/**
+ * arena_alloc() - Allocate zeroed memory until the next arena_release().
+ *
+ * Returns: The buffer or NULL if out of memory.
+ */
+void *arena_alloc(UINTN size)
+{
+	void *ret;
+
+	size = (size + ARENA_ALIGN - 1) & ~(UINTN)(ARENA_ALIGN - 1);
+
+	if (!arena || arena->used + size > arena->pages * EFI_PAGE_SIZE - sizeof(*arena))
+		if (!arena_grow(size))
+			return NULL;
+
+	ret = arena->data + arena->used;
+	arena->used += size;
+
+	arena_stats.allocs++;
+	arena_stats.used += size;
+	if (arena_stats.used > arena_stats.peak)
+		arena_stats.peak = arena_stats.used;
+
+	return ret;
+}
+
+/**
+ * arena_release() - Free everything allocated from the arena.
+ */
+void arena_release(void)
+{
+	struct arena_chunk *chunk;
+
+	if (arena_stats.allocs)
+		Dbg(L"Arena: %d allocs, %d bytes, peak %d bytes in %d chunks\n",
+		    arena_stats.allocs, arena_stats.used, arena_stats.peak, arena_stats.chunks);
+
+	while (arena) {
+		chunk = arena;
+		arena = chunk->next;
+		FreePages((EFI_PHYSICAL_ADDRESS)chunk, chunk->pages);
+	}
+
+	arena_stats.allocs = 0;
+	arena_stats.used = 0;
+	arena_stats.chunks = 0;
+}
+
+/**
+ * arena_get_variable() - Read an EFI variable into the arena.
+ * @name:  Variable name.
+ * @guid:  Vendor GUID.
+ * @size:  Size of the data, can be NULL.
+ *
+ * Returns: Variable data or NULL if it's not set.
+ */
+void *arena_get_variable(CHAR16 *name, EFI_GUID *guid, UINTN *size)
+{
+	EFI_STATUS status;
+	UINTN len = 0;
+	void *buf;
+
+	status = uefi_call_wrapper(RT->GetVariable, 5, name, guid, NULL, &len, NULL);
+	if (status != EFI_BUFFER_TOO_SMALL)
+		return NULL;
+
+	buf = arena_alloc(len);
+	if (!buf)
+		return NULL;
+
+	status = uefi_call_wrapper(RT->GetVariable, 5, name, guid, NULL, &len, buf);
+	if (EFI_ERROR(status))
+		return NULL;
+
+	if (size)
+		*size = len;
+
+	return buf;
+}
+
+/**
+ * arena_locate_handles() - Get all handles with a protocol into the arena.
+ * @protocol:  Protocol GUID.
+ * @count:     Number of handles returned.
+ *
+ * Returns: Array of handles or NULL if there are none.
+ */
+EFI_HANDLE *arena_locate_handles(EFI_GUID *protocol, UINTN *count)
+{
+	EFI_HANDLE *handles;
+	EFI_STATUS status;
+	UINTN size = 0;
+
+	*count = 0;
+
+	status = uefi_call_wrapper(BS->LocateHandle, 5, ByProtocol, protocol, NULL, &size, NULL);
+	if (status != EFI_BUFFER_TOO_SMALL)
+		return NULL;
+
+	handles = arena_alloc(size);
+	if (!handles)
+		return NULL;
+
+	status = uefi_call_wrapper(BS->LocateHandle, 5, ByProtocol, protocol, NULL, &size, handles);
+	if (EFI_ERROR(status))
+		return NULL;
+
+	*count = size / sizeof(*handles);
+
+	return handles;
+}
+
+/**
+ * arena_file_info() - Get EFI_FILE_INFO of an open file into the arena.
+ */
+EFI_FILE_INFO *arena_file_info(EFI_FILE_HANDLE file)
+{
+	EFI_FILE_INFO *info;
+	EFI_STATUS status;
+	UINTN size = 0;
+
+	status = uefi_call_wrapper(file->GetInfo, 4, file, &GenericFileInfo, &size, NULL);
+	if (status != EFI_BUFFER_TOO_SMALL)
+		return NULL;
+
+	info = arena_alloc(size);
+	if (!info)
+		return NULL;
+
+	status = uefi_call_wrapper(file->GetInfo, 4, file, &GenericFileInfo, &size, info);
+	if (EFI_ERROR(status))
+		return NULL;
+
+	return info;
+}
@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Self-benchmark mode.
+ *
+ * Starting dtbloader with "bench [N]" in its load options (i.e. running it
+ * from the UEFI shell) makes it time each stage N times on the real firmware
+ * instead of installing anything. Times are in generic timer ticks.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <string.h>
+#include <util.h>
+#include <timing.h>
+#include <arena.h>
+#include <bench.h>
+
+/**
+ * bench_iterations() - Check load options for "bench [N]".
+ *
+ * Returns: Number of iterations to run or 0 for a normal boot.
+ */
+UINTN bench_iterations(EFI_HANDLE ImageHandle)
+{
+	CHAR16 **argv;
+	INTN argc, i;
+	UINTN n;
+
+	argc = GetShellArgcArgv(ImageHandle, &argv);
+
+	for (i = 0; i < argc; ++i) {
+		if (StrCmp(argv[i], L"bench"))
+			continue;
+
+		n = i + 1 < argc ? Atoi(argv[i + 1]) : 0;
+
+		return n ? n : BENCH_DEFAULT_ITERATIONS;
+	}
+
+	return 0;
+}
+
+static void sort_ticks(UINT64 *ticks, UINTN count)
+{
+	UINTN gap, i, j;
+	UINT64 tmp;
+
+	for (gap = count / 2; gap; gap /= 2) {
+		for (i = gap; i < count; ++i) {
+			tmp = ticks[i];
+			for (j = i; j >= gap && ticks[j - gap] > tmp; j -= gap)
+				ticks[j] = ticks[j - gap];
+			ticks[j] = tmp;
+		}
+	}
+}
+
+/**
+ * bench_run() - Time a stage and print min/median/p99.
+ * @stage:       Stage to run.
+ * @ctx:         Argument for the stage callbacks.
+ * @iterations:  Number of times to run the stage.
+ */
+EFI_STATUS bench_run(const struct bench_stage *stage, void *ctx, UINTN iterations)
+{
+	EFI_STATUS status = EFI_SUCCESS;
+	UINT64 *ticks, start;
+	UINTN i;
+
+	ticks = AllocatePool(iterations * sizeof(*ticks));
+	if (!ticks)
+		return EFI_OUT_OF_RESOURCES;
+
+	for (i = 0; i < iterations; ++i) {
+		if (stage->setup) {
+			status = stage->setup(ctx);
+			if (EFI_ERROR(status))
+				break;
+		}
+
+		start = timer_ticks();
+		status = stage->run(ctx);
+		ticks[i] = timer_ticks() - start;
+
+		/* Every iteration starts with an empty arena, like a real boot. */
+		arena_release();
+
+		if (EFI_ERROR(status))
+			break;
+	}
+
+	if (EFI_ERROR(status)) {
+		Print(L"bench %s: failed on iteration %d: %r\n", stage->name, i, status);
+		FreePool(ticks);
+		return status;
+	}
+
+	sort_ticks(ticks, iterations);
+
+	Print(L"bench %s: min %ld, median %ld, p99 %ld ticks (median %ld us)\n", stage->name,
+	      ticks[0], ticks[iterations / 2], ticks[iterations * 99 / 100],
+	      timer_us(ticks[iterations / 2]));
+
+	FreePool(ticks);
+	return EFI_SUCCESS;
+}
+
+struct memmove_ctx {
+	UINT8 *buf;
+	UINTN size;
+	UINTN offset;
+};
+
+static EFI_STATUS run_memmove_fwd(void *ctx)
+{
+	struct memmove_ctx *m = ctx;
+
+	memmove(m->buf, m->buf + m->offset, m->size);
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS run_memmove_bwd(void *ctx)
+{
+	struct memmove_ctx *m = ctx;
+
+	memmove(m->buf + m->offset, m->buf, m->size);
+	return EFI_SUCCESS;
+}
+
+/**
+ * bench_memmove() - Time overlapping moves of the sizes libfdt does on big DTBs.
+ */
+EFI_STATUS bench_memmove(UINTN iterations)
+{
+	static const struct bench_stage stages[] = {
+		{ .name = L"memmove-fwd", .run = run_memmove_fwd },
+		{ .name = L"memmove-bwd", .run = run_memmove_bwd },
+	};
+	static const UINTN sizes[] = { 256 * 1024, 1024 * 1024 };
+	struct memmove_ctx ctx = { .offset = 64 };
+	UINTN pages = EFI_SIZE_TO_PAGES(sizes[ARRAY_SIZE(sizes) - 1] + ctx.offset);
+	EFI_PHYSICAL_ADDRESS addr;
+	EFI_STATUS status;
+	int i, j;
+
+	status = AllocateZeroPages(pages, &addr);
+	if (EFI_ERROR(status))
+		return status;
+
+	ctx.buf = (UINT8 *)addr;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); ++i) {
+		ctx.size = sizes[i];
+		Print(L"bench memmove: %d KiB\n", ctx.size / 1024);
+
+		for (j = 0; j < ARRAY_SIZE(stages); ++j) {
+			status = bench_run(&stages[j], &ctx, iterations);
+			if (EFI_ERROR(status))
+				goto out;
+		}
+	}
+
+out:
+	FreePages(addr, pages);
+	return status;
+}
@@ -9,73 +9,74 @@
  */
 
 #include <stdbool.h>
-#include <stdarg.h>
+#include <stddef.h>
 #include <efi.h>
 #include <efilib.h>
 #include <sha1.h>
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
 
 #include <util.h>
 #include <device.h>
 #include <chid.h>
+#include <smbios.h>
+#include <sha1x4.h>
 
 /**
- * hash_strings() - Hash a list of strings after concatenating them.
- * @alg:      Algorighm to use from HASH_PROTOCOL.
- * @hash:     Pointer to the result buffer.
- * @seed:     Arbitrary data to prepend to payload.
- * @seed_len: Size of seed.
- * @count:    Amount of strings.
- * @...:  One or more CHAR16 strings to use as message.
+ * struct hashable - Trimmed SMBIOS string, not NUL-terminated.
  */
-static EFI_STATUS hash_strings_sha1(EFI_SHA1_HASH *hash, UINT8 *seed, int seed_len, int count, ...)
-{
-	SHA1_CTX sha1;
-	va_list args;
-	int i;
-
-	SHA1Init(&sha1);
+struct hashable {
+	const CHAR8 *str;
+	UINTN len;
+};
 
-	if (seed)
-		SHA1Update(&sha1, (void*)seed, seed_len);
+static const struct hashable amp = { (const CHAR8 *)"&", 1 };
 
-	va_start(args, count);
+#define WIDEN_BLOCK	64
 
-	for (i = 0; i < count; ++i) {
-		UINT8 *str = va_arg(args, UINT8*);
-		size_t len = StrLen((CHAR16*)str) * sizeof(CHAR16);
+/**
+ * widen() - Convert @len bytes to UTF-16LE.
+ */
+static void widen(UINT16 *out, const UINT8 *in, UINTN len)
+{
+#ifdef __aarch64__
+	uint8x16_t zero = vdupq_n_u8(0);
 
-		if (len == 0)
-			continue;
+	for (; len >= 16; len -= 16, in += 16, out += 16) {
+		uint8x16_t v = vld1q_u8(in);
 
-		SHA1Update(&sha1, (void*)str, len);
+		/* Interleaving with zeroes is the little-endian UTF-16. */
+		vst1q_u8((UINT8 *)out, vzip1q_u8(v, zero));
+		vst1q_u8((UINT8 *)(out + 8), vzip2q_u8(v, zero));
 	}
+#endif
 
-	_Static_assert(sizeof(*hash) == 20, "");
-	SHA1Final((void*)hash, &sha1);
-
-	va_end(args);
-	return EFI_SUCCESS;
+	while (len--)
+		*out++ = *in++;
 }
 
-#define SMBIOS_TYPE_SYSTEM_INFORMATION                   1
-#define SMBIOS_TYPE_BASEBOARD_INFORMATION                2
-
-/*
- * gnu-efi doesn't have the full definition for this sadly...
+/**
+ * sha1_update_wide() - Hash an ASCII string as if it was CHAR16.
+ *
+ * Widens the string in small blocks on the stack, so nothing is allocated.
  */
-#pragma pack(1)
-typedef struct {
-	SMBIOS_HEADER   Hdr;
-	SMBIOS_STRING   Manufacturer;
-	SMBIOS_STRING   ProductName;
-	SMBIOS_STRING   Version;
-	SMBIOS_STRING   SerialNumber;
-	EFI_GUID        Uuid;
-	UINT8           WakeUpType;
-	SMBIOS_STRING   SKUNumber;
-	SMBIOS_STRING   Family;
-} SMBIOS_TYPE1_X;
-#pragma pack()
+static void sha1_update_wide(SHA1_CTX *sha1, const struct hashable *str)
+{
+	UINT16 buf[WIDEN_BLOCK];
+	const UINT8 *p = (const UINT8 *)str->str;
+	UINTN len = str->len, n;
+
+	while (len) {
+		n = len < WIDEN_BLOCK ? len : WIDEN_BLOCK;
+
+		widen(buf, p, n);
+		SHA1Update(sha1, (void*)buf, n * sizeof(*buf));
+
+		p += n;
+		len -= n;
+	}
+}
 
 struct raw_smbios_info {
 	CHAR8 *Manufacturer;
@@ -88,78 +89,43 @@ struct raw_smbios_info {
 
 static EFI_STATUS populate_raw_smbios_info(struct raw_smbios_info *info)
 {
-	EFI_STATUS status;
-
-	SMBIOS_STRUCTURE_TABLE      *SmbiosTable = NULL;
-	SMBIOS3_STRUCTURE_TABLE     *Smbios3Table = NULL;
-	SMBIOS_STRUCTURE_POINTER    Smbios;
-
-	status = LibGetSystemConfigurationTable(&SMBIOSTableGuid, (VOID**)&SmbiosTable);
-	if (EFI_ERROR(status)) {
-
-		status = LibGetSystemConfigurationTable(&SMBIOS3TableGuid, (VOID**)&Smbios3Table);
-		if (EFI_ERROR(status))
-			return EFI_NOT_FOUND;
-	}
-
-	if (SmbiosTable)
-		Smbios.Hdr = (SMBIOS_HEADER *)SmbiosTable->TableAddress;
-	else if (Smbios3Table)
-		Smbios.Hdr = (SMBIOS_HEADER *)Smbios3Table->TableAddress;
-	else
+	if (!smbios_find(SMBIOS_TYPE_SYSTEM_INFORMATION, 0))
 		return EFI_NOT_FOUND;
 
-	info->Manufacturer = NULL;
-	info->ProductName = NULL;
-	info->ProductSku = NULL;
-	info->Family = NULL;
-	info->BaseboardManufacturer = NULL;
-	info->BaseboardProduct = NULL;
-
-	while (Smbios.Hdr->Type != 127) {
-
-		switch (Smbios.Hdr->Type) {
-		case SMBIOS_TYPE_SYSTEM_INFORMATION:
-			info->Manufacturer = LibGetSmbiosString(&Smbios, Smbios.Type1->Manufacturer);
-			info->ProductName = LibGetSmbiosString(&Smbios, Smbios.Type1->ProductName);
-			info->ProductSku = LibGetSmbiosString(&Smbios, ((SMBIOS_TYPE1_X*)Smbios.Raw)->SKUNumber);
-			info->Family = LibGetSmbiosString(&Smbios, ((SMBIOS_TYPE1_X*)Smbios.Raw)->Family);
-			break;
-
-		case SMBIOS_TYPE_BASEBOARD_INFORMATION:
-			info->BaseboardManufacturer = LibGetSmbiosString(&Smbios, Smbios.Type2->Manufacturer);
-			info->BaseboardProduct = LibGetSmbiosString(&Smbios, Smbios.Type2->ProductName);
-			break;
-		}
-
-		LibGetSmbiosString(&Smbios, -1);
-	}
+	info->Manufacturer = smbios_get_string(SMBIOS_TYPE_SYSTEM_INFORMATION,
+					       offsetof(SMBIOS_TYPE1_X, Manufacturer));
+	info->ProductName = smbios_get_string(SMBIOS_TYPE_SYSTEM_INFORMATION,
+					      offsetof(SMBIOS_TYPE1_X, ProductName));
+	info->ProductSku = smbios_get_string(SMBIOS_TYPE_SYSTEM_INFORMATION,
+					     offsetof(SMBIOS_TYPE1_X, SKUNumber));
+	info->Family = smbios_get_string(SMBIOS_TYPE_SYSTEM_INFORMATION,
+					 offsetof(SMBIOS_TYPE1_X, Family));
+	info->BaseboardManufacturer = smbios_get_string(SMBIOS_TYPE_BASEBOARD_INFORMATION,
+							offsetof(SMBIOS_TYPE2, Manufacturer));
+	info->BaseboardProduct = smbios_get_string(SMBIOS_TYPE_BASEBOARD_INFORMATION,
+						   offsetof(SMBIOS_TYPE2, ProductName));
 
 	return EFI_SUCCESS;
 }
 
 struct smbios_info {
-	CHAR16 *Manufacturer;
-	CHAR16 *ProductName;
-	CHAR16 *ProductSku;
-	CHAR16 *Family;
-	CHAR16 *BaseboardProduct;
-	CHAR16 *BaseboardManufacturer;
+	struct hashable Manufacturer;
+	struct hashable ProductName;
+	struct hashable ProductSku;
+	struct hashable Family;
+	struct hashable BaseboardProduct;
+	struct hashable BaseboardManufacturer;
 };
 
 /**
- * smbios_to_hashable_string() - Convert ascii smbios string to stripped CHAR16.
+ * smbios_to_hashable_string() - Strip an ascii smbios string in place.
  */
-static CHAR16 *smbios_to_hashable_string(CHAR8* str)
+static struct hashable smbios_to_hashable_string(CHAR8 *str)
 {
-	int len, i;
-	CHAR16 *ret;
+	struct hashable ret = { (const CHAR8 *)"", 0 };
 
-	if (!str) {
-		/* User of this function is expected to free the result. */
-		ret = AllocateZeroPool(sizeof(*ret));
+	if (!str)
 		return ret;
-	}
 
 	/*
 	 * We need to strip leading and trailing spaces, leading zeroes.
@@ -171,17 +137,11 @@ static CHAR16 *smbios_to_hashable_string(CHAR8* str)
 	while (*str == '0')
 		str++;
 
-	len = strlena(str);
-
-	while (len && str[len-1] == ' ')
-		len--;
+	ret.str = str;
+	ret.len = strlena(str);
 
-	ret = AllocateZeroPool((len+1) * sizeof(*ret));
-	if (!ret)
-		return NULL;
-
-	for (i = 0; i < len; ++i)
-		ret[i] = str[i];
+	while (ret.len && str[ret.len-1] == ' ')
+		ret.len--;
 
 	return ret;
 }
@@ -205,103 +165,63 @@ static EFI_STATUS populate_smbios_info(struct smbios_info *info)
 	return EFI_SUCCESS;
 }
 
-static void free_smbios_info(struct smbios_info *info)
-{
-	if (info->Manufacturer)
-		FreePool(info->Manufacturer);
-	if (info->ProductName)
-		FreePool(info->ProductName);
-	if (info->ProductSku)
-		FreePool(info->ProductSku);
-	if (info->Family)
-		FreePool(info->Family);
-	if (info->BaseboardProduct)
-		FreePool(info->BaseboardProduct);
-	if (info->BaseboardManufacturer)
-		FreePool(info->BaseboardManufacturer);
-}
+/* Fields hashed for each CHID, joined with '&' in this order. */
+#define CHID_MANUFACTURER		(1 << 0)
+#define CHID_FAMILY			(1 << 1)
+#define CHID_PRODUCT_NAME		(1 << 2)
+#define CHID_PRODUCT_SKU		(1 << 3)
+#define CHID_BASEBOARD_MANUFACTURER	(1 << 4)
+#define CHID_BASEBOARD_PRODUCT		(1 << 5)
+
+static const UINT8 chid_fields[CHID_COUNT] = {
+	[3]  = CHID_MANUFACTURER | CHID_FAMILY | CHID_PRODUCT_NAME | CHID_PRODUCT_SKU |
+	       CHID_BASEBOARD_MANUFACTURER | CHID_BASEBOARD_PRODUCT,
+	[4]  = CHID_MANUFACTURER | CHID_FAMILY | CHID_PRODUCT_NAME | CHID_PRODUCT_SKU,
+	[5]  = CHID_MANUFACTURER | CHID_FAMILY | CHID_PRODUCT_NAME,
+	[6]  = CHID_MANUFACTURER | CHID_PRODUCT_SKU | CHID_BASEBOARD_MANUFACTURER |
+	       CHID_BASEBOARD_PRODUCT,
+	[7]  = CHID_MANUFACTURER | CHID_PRODUCT_SKU,
+	[8]  = CHID_MANUFACTURER | CHID_PRODUCT_NAME | CHID_BASEBOARD_MANUFACTURER |
+	       CHID_BASEBOARD_PRODUCT,
+	[9]  = CHID_MANUFACTURER | CHID_PRODUCT_NAME,
+	[10] = CHID_MANUFACTURER | CHID_FAMILY | CHID_BASEBOARD_MANUFACTURER |
+	       CHID_BASEBOARD_PRODUCT,
+	[11] = CHID_MANUFACTURER | CHID_FAMILY,
+	[13] = CHID_MANUFACTURER | CHID_BASEBOARD_MANUFACTURER | CHID_BASEBOARD_PRODUCT,
+	[14] = CHID_MANUFACTURER,
+	/* Others use fields we don't hash (BIOS, enclosure), keep them empty to prevent match. */
+};
 
-static EFI_STATUS get_chid(struct smbios_info *info, int id, EFI_GUID *chid)
+static const EFI_GUID chid_namespace = { 0x12d8ff70, 0x7f4c, 0x7d4c, { 0 } }; /* Swapped to BE */
+
+/**
+ * chid_parts() - Get the strings to hash for a CHID, '&' separators included.
+ * @parts:  Array of at least 11 entries to fill.
+ *
+ * Returns: Number of parts, 0 if the CHID isn't computed.
+ */
+static int chid_parts(struct smbios_info *info, int id, const struct hashable **parts)
 {
-	EFI_STATUS status;
-	EFI_GUID namespace = { 0x12d8ff70, 0x7f4c, 0x7d4c, { 0 } }; /* Swapped to BE */
-	EFI_SHA1_HASH hash = {0};
+	const struct hashable *fields[] = {
+		&info->Manufacturer, &info->Family, &info->ProductName, &info->ProductSku,
+		&info->BaseboardManufacturer, &info->BaseboardProduct,
+	};
+	int i, n = 0;
+
+	for (i = 0; i < ARRAY_SIZE(fields); ++i) {
+		if (!(chid_fields[id] & (1 << i)))
+			continue;
 
-	switch (id) {
-	case 3:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 11,
-				info->Manufacturer, L"&",
-				info->Family, L"&",
-				info->ProductName, L"&",
-				info->ProductSku, L"&",
-				info->BaseboardManufacturer, L"&",
-				info->BaseboardProduct);
-		break;
-	case 4:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 7,
-				info->Manufacturer, L"&",
-				info->Family, L"&",
-				info->ProductName, L"&",
-				info->ProductSku);
-		break;
-	case 5:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 5,
-				info->Manufacturer, L"&",
-				info->Family, L"&",
-				info->ProductName);
-		break;
-	case 6:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 7,
-				info->Manufacturer, L"&",
-				info->ProductSku, L"&",
-				info->BaseboardManufacturer, L"&",
-				info->BaseboardProduct);
-		break;
-	case 7:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 3,
-				info->Manufacturer, L"&",
-				info->ProductSku);
-		break;
-	case 8:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 7,
-				info->Manufacturer, L"&",
-				info->ProductName, L"&",
-				info->BaseboardManufacturer, L"&",
-				info->BaseboardProduct);
-		break;
-	case 9:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 3,
-				info->Manufacturer, L"&",
-				info->ProductName);
-		break;
-	case 10:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 7,
-				info->Manufacturer, L"&",
-				info->Family, L"&",
-				info->BaseboardManufacturer, L"&",
-				info->BaseboardProduct);
-		break;
-	case 11:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 3,
-				info->Manufacturer, L"&",
-				info->Family);
-		break;
-	case 13:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 5,
-				info->Manufacturer, L"&",
-				info->BaseboardManufacturer, L"&",
-				info->BaseboardProduct);
-		break;
-	case 14:
-		status = hash_strings_sha1(&hash, (UINT8*)&namespace, sizeof(namespace), 1,
-				info->Manufacturer);
-		break;
-	default:
-		return EFI_SUCCESS; /* Just keep empty to prevent match. */
+		if (n)
+			parts[n++] = &amp;
+		parts[n++] = fields[i];
 	}
-	if (EFI_ERROR(status))
-		return status;
 
+	return n;
+}
+
+static void hash_to_chid(UINT8 *hash, EFI_GUID *chid)
+{
 	CopyMem(chid, hash, sizeof(*chid));
 
 	/* Convert the resulting CHID back to little-endian: */
@@ -312,15 +232,149 @@ static EFI_STATUS get_chid(struct smbios_info *info, int id, EFI_GUID *chid)
 	/* set specific bits according to RFC4122 Section 4.1.3 */
 	chid->Data3    = (chid->Data3 & 0x0fff) | (5 << 12);
 	chid->Data4[0] = (chid->Data4[0] & 0x3f) | 0x80;
+}
 
-	return EFI_SUCCESS;
+/**
+ * get_chid() - Compute one CHID with the SHA-1 library.
+ */
+static void get_chid(struct smbios_info *info, int id, EFI_GUID *chid)
+{
+	const struct hashable *parts[11];
+	EFI_SHA1_HASH hash = {0};
+	SHA1_CTX sha1;
+	int i, n;
+
+	n = chid_parts(info, id, parts);
+	if (!n)
+		return; /* Just keep empty to prevent match. */
+
+	SHA1Init(&sha1);
+	SHA1Update(&sha1, (void*)&chid_namespace, sizeof(chid_namespace));
+
+	for (i = 0; i < n; ++i)
+		sha1_update_wide(&sha1, parts[i]);
+
+	_Static_assert(sizeof(hash) == 20, "");
+	SHA1Final((void*)hash, &sha1);
+
+	hash_to_chid(hash, chid);
+}
+
+/**
+ * chid_message() - Build the whole hashed message of a CHID.
+ * @buf:   Buffer for the message.
+ * @size:  Size of the buffer.
+ *
+ * Returns: Size of the message, 0 if the CHID isn't computed or it doesn't fit.
+ */
+static UINTN chid_message(struct smbios_info *info, int id, UINT8 *buf, UINTN size)
+{
+	const struct hashable *parts[11];
+	UINTN len = sizeof(chid_namespace);
+	int i, n;
+
+	n = chid_parts(info, id, parts);
+	if (!n)
+		return 0;
+
+	CopyMem(buf, (void*)&chid_namespace, sizeof(chid_namespace));
+
+	for (i = 0; i < n; ++i) {
+		if (parts[i]->len > (size - len) / sizeof(UINT16))
+			return 0;
+
+		widen((UINT16 *)(buf + len), (const UINT8 *)parts[i]->str, parts[i]->len);
+		len += parts[i]->len * sizeof(UINT16);
+	}
+
+	return len;
+}
+
+#define CHID_MESSAGE_MAX	512
+
+static void hash_chids_x4(const UINT8 *msg[SHA1X4_LANES], UINTN len[SHA1X4_LANES],
+			  int ids[SHA1X4_LANES], int count, EFI_GUID *hwids)
+{
+	UINT8 digest[SHA1X4_LANES][SHA1_DIGEST_SIZE];
+	int i;
+
+	for (i = count; i < SHA1X4_LANES; ++i)
+		msg[i] = NULL;
+
+	sha1x4(msg, len, digest);
+
+	for (i = 0; i < count; ++i)
+		hash_to_chid(digest[i], &hwids[ids[i]]);
+}
+
+/**
+ * get_chids_x4() - Compute a set of CHIDs, four at a time.
+ *
+ * Messages that don't fit the lane buffers (very long SMBIOS strings)
+ * are hashed with get_chid() instead.
+ */
+static void get_chids_x4(struct smbios_info *info, EFI_GUID *hwids)
+{
+	UINT16 buf[SHA1X4_LANES][CHID_MESSAGE_MAX / sizeof(UINT16)];
+	const UINT8 *msg[SHA1X4_LANES];
+	UINTN len[SHA1X4_LANES];
+	int ids[SHA1X4_LANES];
+	int id, lane = 0;
+
+	for (id = 0; id < CHID_COUNT; ++id) {
+		if (!chid_fields[id])
+			continue;
+
+		len[lane] = chid_message(info, id, (UINT8 *)buf[lane], sizeof(buf[lane]));
+		if (!len[lane]) {
+			get_chid(info, id, &hwids[id]);
+			continue;
+		}
+
+		msg[lane] = (UINT8 *)buf[lane];
+		ids[lane++] = id;
+
+		if (lane == SHA1X4_LANES) {
+			hash_chids_x4(msg, len, ids, lane, hwids);
+			lane = 0;
+		}
+	}
+
+	if (lane)
+		hash_chids_x4(msg, len, ids, lane, hwids);
 }
 
 /**
  * populate_board_hwids() - Read board SMBIOS and produce an array of CHID values.
- * @hwids:  Pointer to an array of 12 chids to be filled.
+ * @hwids:  Pointer to an array of 15 chids to be filled.
+ *
+ * The CHIDs are independent short messages so they are hashed in
+ * parallel lanes, see sha1x4.c.
  */
 EFI_STATUS populate_board_hwids(EFI_GUID *hwids)
+{
+	EFI_STATUS status;
+	struct smbios_info info;
+
+	if (!hwids)
+		return EFI_INVALID_PARAMETER;
+
+	status = populate_smbios_info(&info);
+	if (EFI_ERROR(status))
+		return status;
+
+	get_chids_x4(&info, hwids);
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * populate_board_hwids_serial() - Same as populate_board_hwids(), one CHID at a time.
+ * @hwids:  Pointer to an array of 15 chids to be filled.
+ *
+ * Only kept as the reference for checking and benchmarking the batched one.
+ */
+EFI_STATUS populate_board_hwids_serial(EFI_GUID *hwids)
 {
 	EFI_STATUS status;
 	struct smbios_info info;
@@ -333,13 +387,8 @@ EFI_STATUS populate_board_hwids(EFI_GUID *hwids)
 	if (EFI_ERROR(status))
 		return status;
 
-	for (i = 0; i < 15; ++i) {
-		status = get_chid(&info, i, &hwids[i]);
-		if (EFI_ERROR(status))
-			goto exit;
-	}
+	for (i = 0; i < CHID_COUNT; ++i)
+		get_chid(&info, i, &hwids[i]);
 
-exit:
-	free_smbios_info(&info);
-	return status;
+	return EFI_SUCCESS;
 }
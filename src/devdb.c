@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Device database loaded from the ESP.
+ *
+ * \dtbloader\devices.db lets new boards be supported without rebuilding
+ * and re-signing dtbloader.efi. It's generated by "dtbloader-mkdb" from
+ * the same device descriptions as the built-in table, which is still
+ * used when the database has no match.
+ *
+ * The file is read once and used in place: lookups binary search the
+ * sorted CHID index and only look at the records of the hits, so the
+ * cost doesn't depend on the number of boards in it. Devices needing
+ * code (rules, extra_match, fixups) or prune flags refer to a built-in device
+ * by name.
+ *
+ * With Secure Boot enabled, a changed database has to be confirmed by the
+ * user before use, same as the DTB.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+#include <sha1.h>
+
+#include <util.h>
+#include <device.h>
+#include <devdb.h>
+#include <rules.h>
+#include <arena.h>
+
+static UINT8 *db;
+static struct devdb_header *hdr;
+
+static EFI_GUID devdb_no_hwids[] = { { } };
+static struct device devdb_dev;
+
+static bool range_ok(UINT32 off, UINT64 count, UINT64 size, UINT32 align)
+{
+	return !(off % align) && off + count * size <= hdr->size;
+}
+
+static EFI_STATUS devdb_check(UINTN size)
+{
+	CHAR16 *strings;
+
+	if (size < sizeof(*hdr))
+		return EFI_LOAD_ERROR;
+
+	hdr = (struct devdb_header *)db;
+
+	if (hdr->magic != DEVDB_MAGIC || hdr->version != DEVDB_VERSION || hdr->size != size)
+		return EFI_LOAD_ERROR;
+
+	if (!range_ok(hdr->devices, hdr->device_count, sizeof(struct devdb_device), 4) ||
+	    !range_ok(hdr->chids, hdr->chid_count, sizeof(struct devdb_chid), 4) ||
+	    !range_ok(hdr->strings, hdr->strings_size, 1, 2) ||
+	    hdr->strings_size < sizeof(CHAR16) || hdr->strings_size % sizeof(CHAR16))
+		return EFI_LOAD_ERROR;
+
+	/* Every string offset is then terminated within the table. */
+	strings = (CHAR16 *)(db + hdr->strings);
+	if (strings[0] || strings[hdr->strings_size / sizeof(CHAR16) - 1])
+		return EFI_LOAD_ERROR;
+
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS devdb_verify(UINTN size)
+{
+	EFI_GUID var_guid = DTBLOADER_VARIABLE_GUID;
+	EFI_SHA1_HASH hash, *old_hash;
+	bool hashes_match = false;
+
+	if (!SecureBootEnabled())
+		return EFI_SUCCESS;
+
+	SHA1((void *)&hash, (void *)db, size);
+
+	old_hash = arena_get_variable(L"DtbloaderDbHash", &var_guid, NULL);
+	if (old_hash)
+		hashes_match = !CompareMem(old_hash, &hash, sizeof(*old_hash));
+
+	if (hashes_match)
+		return EFI_SUCCESS;
+
+	return ConfirmHashChange(L"DtbloaderDbHash", &var_guid, &hash,
+				 L"(dtbloader) Device database has changed! Press any key to confirm...");
+}
+
+/**
+ * devdb_load() - Read and verify the device database, if there is one.
+ *
+ * Returns: EFI_NOT_FOUND if there is no database, an error if it is
+ * invalid or rejected, in which case only the built-in table is used.
+ */
+EFI_STATUS devdb_load(EFI_HANDLE ImageHandle)
+{
+	EFI_FILE_HANDLE volume, file;
+	EFI_STATUS status;
+	UINT64 size;
+
+	volume = GetVolume(ImageHandle);
+	if (!volume)
+		return EFI_NOT_FOUND;
+
+	file = FileOpen(volume, DEVDB_FILE_NAME);
+	if (!file)
+		return EFI_NOT_FOUND;
+
+	size = FileSize(file);
+	db = AllocatePool(size);
+	if (!db) {
+		FileClose(file);
+		return EFI_OUT_OF_RESOURCES;
+	}
+
+	size = FileRead(file, db, size);
+	FileClose(file);
+
+	status = devdb_check(size);
+	if (!EFI_ERROR(status))
+		status = devdb_verify(size);
+
+	if (EFI_ERROR(status)) {
+		FreePool(db);
+		db = NULL;
+		hdr = NULL;
+		return status;
+	}
+
+	Dbg(L"Device database: %d devices, %d CHIDs\n", hdr->device_count, hdr->chid_count);
+
+	return EFI_SUCCESS;
+}
+
+static CHAR16 *devdb_string(UINT32 off)
+{
+	if (off % sizeof(CHAR16) || off >= hdr->strings_size)
+		return NULL;
+
+	return (CHAR16 *)(db + hdr->strings + off);
+}
+
+static struct device *find_builtin(CHAR16 *name)
+{
+	struct device **dev;
+
+	for_each_device(dev)
+		if (!StrCmp((*dev)->name, name))
+			return *dev;
+
+	return NULL;
+}
+
+/**
+ * devdb_device() - Fill devdb_dev from a database record.
+ *
+ * Returns: EFI_SUCCESS if the record is valid and its rules and extra_match pass.
+ */
+static EFI_STATUS devdb_device(UINT32 index)
+{
+	struct devdb_device *rec;
+	struct device *builtin = NULL;
+	CHAR16 *fixup;
+
+	if (index >= hdr->device_count)
+		return EFI_LOAD_ERROR;
+
+	rec = (struct devdb_device *)(db + hdr->devices) + index;
+
+	devdb_dev = (struct device) {
+		.name = devdb_string(rec->name),
+		.dtb = devdb_string(rec->dtb),
+		.hwids = devdb_no_hwids,
+	};
+
+	fixup = devdb_string(rec->fixup);
+	if (!devdb_dev.name || !devdb_dev.dtb || !fixup)
+		return EFI_LOAD_ERROR;
+
+	if (fixup[0]) {
+		builtin = find_builtin(fixup);
+		if (!builtin) {
+			Dbg(L"Device database: %s needs unknown fixup %s\n", devdb_dev.name, fixup);
+			return EFI_UNSUPPORTED;
+		}
+
+		devdb_dev.rules = builtin->rules;
+		devdb_dev.extra_match = builtin->extra_match;
+		devdb_dev.prefetch = builtin->prefetch;
+		devdb_dev.dt_fixup = builtin->dt_fixup;
+		devdb_dev.dt_prune = builtin->dt_prune;
+	}
+
+	if (!match_rules(&devdb_dev))
+		return EFI_UNSUPPORTED;
+
+	if (devdb_dev.extra_match)
+		return devdb_dev.extra_match(&devdb_dev);
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * devdb_lookup() - Find the device with this CHID in the database.
+ *
+ * Returns: The device or NULL if there's no database or no match. The
+ * returned structure is reused by the next lookup.
+ */
+struct device *devdb_lookup(EFI_GUID *chid)
+{
+	struct devdb_chid *chids;
+	UINT32 lo = 0, hi, mid, i;
+
+	if (!db)
+		return NULL;
+
+	chids = (struct devdb_chid *)(db + hdr->chids);
+	hi = hdr->chid_count;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (CompareMem(&chids[mid].chid, chid, sizeof(*chid)) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = lo; i < hdr->chid_count && !CompareMem(&chids[i].chid, chid, sizeof(*chid)); ++i)
+		if (devdb_device(chids[i].device) == EFI_SUCCESS)
+			return &devdb_dev;
+
+	return NULL;
+}
@@ -8,66 +8,273 @@
 #include <util.h>
 #include <device.h>
 #include <chid.h>
+#include <devdb.h>
+#include <rules.h>
+#include <mp.h>
 
+#ifdef DTBLOADER_HOST
+extern struct device *__start_dtbloader_devs[], *__stop_dtbloader_devs[];
+extern struct device *__start_dtbloader_devs_end[] __attribute__((weak));
+extern struct device *__stop_dtbloader_devs_end[] __attribute__((weak));
+#else
 #pragma section(".devs", read)
 
 __declspec(allocate(".devs$a")) struct device *__start_dtbloader_dev = NULL;
 __declspec(allocate(".devs$d")) struct device *__stop_dtbloader_dev = NULL;
-
+#endif
 
 /**
- * match_device() - Detect the device.
+ * next_device() - Get the next entry in the device table.
+ * @dev:  Current entry or NULL to get the first one.
  *
- * This function attempts to find the device structure for the
- * machine that dtbloader is running on.
- *
- * Returns: Pointer to the device structure or NULL on failure.
+ * Returns: Pointer to the next entry or NULL at the end of the table.
  */
-struct device *match_device(void)
+struct device **next_device(struct device **dev)
+{
+#ifdef DTBLOADER_HOST
+	/*
+	 * The linker may place the two sections in any order and the _end
+	 * one is missing if no device uses DEVICE_DESC_END(), so every entry
+	 * is only checked against the bounds of its own section.
+	 */
+	if (!dev) {
+		dev = __start_dtbloader_devs;
+	} else if (dev >= __start_dtbloader_devs && dev < __stop_dtbloader_devs) {
+		dev++;
+	} else {
+		dev++;
+		return dev < __stop_dtbloader_devs_end ? dev : NULL;
+	}
+
+	if (dev < __stop_dtbloader_devs)
+		return dev;
+
+	if (__start_dtbloader_devs_end == __stop_dtbloader_devs_end)
+		return NULL;
+
+	return __start_dtbloader_devs_end;
+#else
+	if (!dev)
+		dev = &__start_dtbloader_dev;
+
+	dev++;
+
+	return dev < &__stop_dtbloader_dev ? dev : NULL;
+#endif
+}
+
+
+static EFI_GUID board_hwids[15];
+static EFI_STATUS board_hwids_status;
+static struct mp_job board_hwids_job;
+static bool board_hwids_started;
+static bool board_hwids_valid;
+static struct match_result board_match;
+
+static const int priority[] = { /* From most to least specific. */
+	3,  /* Manufacturer + Family + ProductName + ProductSku + BaseboardManufacturer + BaseboardProduct */
+	6,  /* Manufacturer +                        ProductSku + BaseboardManufacturer + BaseboardProduct */
+	8,  /* Manufacturer +          ProductName +              BaseboardManufacturer + BaseboardProduct */
+	10, /* Manufacturer + Family +                            BaseboardManufacturer + BaseboardProduct */
+	4,  /* Manufacturer + Family + ProductName + ProductSku */
+	5,  /* Manufacturer + Family + ProductName */
+	7,  /* Manufacturer +                        ProductSku */
+	9,  /* Manufacturer +          ProductName */
+	11, /* Manufacturer + Family */
+};
+
+/**
+ * find_device() - Look the device up by its CHIDs.
+ * @hwids:   CHIDs of the board.
+ * @status:  Result of computing @hwids.
+ * @res:     How the device was matched.
+ */
+static struct device *find_device(EFI_GUID *hwids, EFI_STATUS status, struct match_result *res)
 {
-	EFI_STATUS status;
 	struct device **dev;
-	static struct device *cached_dev = NULL;
-	EFI_GUID hwids[15] = {0};
-	int priority[] = { /* From most to least specific. */
-		3,  /* Manufacturer + Family + ProductName + ProductSku + BaseboardManufacturer + BaseboardProduct */
-		6,  /* Manufacturer +                        ProductSku + BaseboardManufacturer + BaseboardProduct */
-		8,  /* Manufacturer +          ProductName +              BaseboardManufacturer + BaseboardProduct */
-		10, /* Manufacturer + Family +                            BaseboardManufacturer + BaseboardProduct */
-		4,  /* Manufacturer + Family + ProductName + ProductSku */
-		5,  /* Manufacturer + Family + ProductName */
-		7,  /* Manufacturer +                        ProductSku */
-		9,  /* Manufacturer +          ProductName */
-		11, /* Manufacturer + Family */
-	};
+	struct device *db_dev;
 	int i, j;
 
-	if (cached_dev)
-		return cached_dev;
-
-	status = populate_board_hwids(hwids);
 	if (EFI_ERROR(status)) {
 		Print(L"Failed to populate board hwids: %r\n", status);
 		return NULL;
 	}
 
+	rules_compile(hwids, ARRAY_SIZE(board_hwids));
+
 	for (i = 0; i < ARRAY_SIZE(priority); ++i) {
-		for (dev = &__start_dtbloader_dev + 1; dev < &__stop_dtbloader_dev; dev++) {
+		EFI_GUID *hwid = &hwids[priority[i]];
+
+		res->chid = priority[i];
+		res->level = i;
+
+		/* The database from the ESP is newer than the built-in table. */
+		db_dev = devdb_lookup(hwid);
+		if (db_dev) {
+			res->devdb = true;
+			return db_dev;
+		}
+
+		for_each_device(dev) {
 			for (j = 0; (*dev)->hwids[j].Data1; ++j) {
-				if (!CompareGuid(&hwids[i], &(*dev)->hwids[j])) {
+				if (!CompareGuid(hwid, &(*dev)->hwids[j])) {
+					if (!match_rules(*dev))
+						continue;
+
 					if ((*dev)->extra_match && (*dev)->extra_match(*dev) != EFI_SUCCESS)
 						continue;
 
-					cached_dev = *dev;
 					return *dev;
 				}
 			}
 		}
 	}
 
+	res->chid = MATCH_NONE;
+	res->level = MATCH_NONE;
+
 	return NULL;
 }
 
+/**
+ * detect_device() - Look the device up, ignoring the cached result.
+ *
+ * Returns: Pointer to the device structure or NULL on failure.
+ */
+struct device *detect_device(void)
+{
+	EFI_GUID hwids[15] = {0};
+	struct match_result res = {0};
+
+	return find_device(hwids, populate_board_hwids(hwids), &res);
+}
+
+#ifdef DTBLOADER_HOST
+static UINTN add_candidate(struct device **out, UINTN count, struct device *dev)
+{
+	UINTN i;
+
+	for (i = 0; i < count; ++i)
+		if (out[i] == dev)
+			return count;
+
+	out[count] = dev;
+
+	return count + 1;
+}
+
+/**
+ * match_candidates() - List every device detect_device() could pick.
+ * @out:  Array for the candidates, in the order they'd be tried.
+ * @max:  Size of @out.
+ *
+ * Walks the CHIDs the same way as detect_device() but skips the variant
+ * checks (.rules and .extra_match), which need firmware tables the host
+ * tools don't have. The walk stops at the first candidate without any
+ * checks, since that one is always picked once it's reached. Database
+ * records still go through devdb_lookup(), which runs their checks, and
+ * also end the walk as the record is reused by the next lookup.
+ *
+ * Returns: Number of candidates stored in @out.
+ */
+UINTN match_candidates(struct device **out, UINTN max)
+{
+	EFI_GUID hwids[15] = {0};
+	struct device **dev;
+	struct device *db_dev;
+	UINTN count = 0;
+	int i, j;
+
+	if (EFI_ERROR(populate_board_hwids(hwids)))
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(priority); ++i) {
+		EFI_GUID *hwid = &hwids[priority[i]];
+
+		db_dev = devdb_lookup(hwid);
+		if (db_dev)
+			return add_candidate(out, count, db_dev);
+
+		for_each_device(dev) {
+			for (j = 0; (*dev)->hwids[j].Data1; ++j) {
+				if (CompareGuid(hwid, &(*dev)->hwids[j]))
+					continue;
+
+				count = add_candidate(out, count, *dev);
+				if (count == max || (!(*dev)->rules && !(*dev)->extra_match))
+					return count;
+			}
+		}
+	}
+
+	return count;
+}
+#endif
+
+static void board_hwids_compute(void *arg)
+{
+	board_hwids_status = populate_board_hwids(board_hwids);
+}
+
+/**
+ * match_device_start() - Start computing the CHIDs for match_device().
+ *
+ * Hashing the SMBIOS strings only reads memory, so it's done on another
+ * CPU if there is one while the caller keeps doing firmware I/O, i.e.
+ * loading the device database. match_device() waits for the result.
+ */
+void match_device_start(void)
+{
+	if (board_hwids_started)
+		return;
+
+	board_hwids_started = true;
+	mp_job_start(&board_hwids_job, board_hwids_compute, NULL);
+}
+
+/**
+ * match_device() - Detect the device.
+ *
+ * This function attempts to find the device structure for the
+ * machine that dtbloader is running on.
+ *
+ * Returns: Pointer to the device structure or NULL on failure.
+ */
+struct device *match_device(void)
+{
+	static struct device *cached_dev = NULL;
+
+	if (!cached_dev) {
+		match_device_start();
+		mp_job_wait(&board_hwids_job);
+
+		cached_dev = find_device(board_hwids, board_hwids_status, &board_match);
+		board_hwids_valid = true;
+	}
+
+	return cached_dev;
+}
+
+/**
+ * match_hwids() - Get the CHIDs computed by match_device().
+ *
+ * Returns: Array of 15 CHIDs or NULL if match_device() wasn't called yet.
+ */
+EFI_GUID *match_hwids(void)
+{
+	return board_hwids_valid ? board_hwids : NULL;
+}
+
+/**
+ * match_result() - Get which CHID match_device() found the device with.
+ *
+ * Returns: The result or NULL if match_device() wasn't called yet.
+ */
+struct match_result *match_result(void)
+{
+	return board_hwids_valid ? &board_match : NULL;
+}
+
 static bool dt_check_existing_mac_prop(void *dtb, int node, const char *prop)
 {
 	const uint8_t *val;
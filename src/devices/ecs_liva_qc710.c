@@ -26,6 +26,7 @@ static struct device ecs_liva_qc710_dev = {
 	.dtb   = L"qcom\\sc7180-ecs-liva-qc710.dtb",
 	.hwids = ecs_liva_qc710_hwids,
 
+	.prefetch = qcom_dpp_prefetch,
 	.dt_fixup = qcom_dt_set_dpp_mac,
 };
 DEVICE_DESC(ecs_liva_qc710_dev);
@@ -4,6 +4,7 @@
 #include <efi.h>
 #include <efilib.h>
 #include <device.h>
+#include <rules.h>
 
 /*
  * https://github.com/aarch64-laptops/build/blob/master/misc/lenovo-thinkpad-t14s-120hz-64gb/acpi/dsdt.dsl
@@ -13,6 +14,9 @@
  *     OperationRegion (MNVS, SystemMemory, 0xD6CF5018, 0x6000)
  *     (...)
  * }
+ *
+ * The base below is only what the layout was taken from, the region is
+ * looked up in the DSDT at runtime.
  */
 #define T14S_MVNS_BASE      0xD6CF5018
 #define T14S_MVNS_SIZE      0x6000
@@ -46,21 +50,11 @@ _Static_assert(T14S_MVNS_BASE + offsetof(struct t14s_mvns, tlpi) == 0xd6cf5fbc +
 _Static_assert(T14S_MVNS_BASE + offsetof(struct t14s_mvns, fadm) == 0xd6cf5fbc + 5, "");
 
 
-static EFI_STATUS t14s_is_oled(struct device *dev)
-{
-	struct t14s_mvns *mvns;
-
-	/*
-	 * This is theoretically not very safe and nice as we blatantly
-	 * hardcode some random address we found in acpi tables and read
-	 * from it... The hope here is Lenovo will be too lazy to ever
-	 * change this struct and relevant acpi structure layout.
-	 */
-	mvns = (void*)(uintptr_t)T14S_MVNS_BASE;
-
-	/* Panel XML with index 4 has Backlight Type = 5 and not 1(pmic pwm). */
-	return (mvns->vpid == 4 ? EFI_SUCCESS : EFI_UNSUPPORTED);
-}
+/* Panel XML with index 4 has Backlight Type = 5 and not 1(pmic pwm). */
+static const struct match_rule t14s_oled_rules[] = {
+	MATCH_ACPI_REGION_U8("MNVS", offsetof(struct t14s_mvns, vpid), 4),
+	MATCH_END
+};
 
 static EFI_GUID lenovo_thinkpad_t14s_gen_6_hwids[] = {
 	/* Common */
@@ -104,8 +98,7 @@ static struct device lenovo_thinkpad_t14s_gen_6_oled_dev = {
 	.name  = L"LENOVO ThinkPad T14s Gen 6 (OLED)",
 	.dtb   = L"qcom\\x1e78100-lenovo-thinkpad-t14s-oled.dtb",
 	.hwids = lenovo_thinkpad_t14s_gen_6_hwids,
-
-	.extra_match = t14s_is_oled,
+	.rules = t14s_oled_rules,
 };
 DEVICE_DESC(lenovo_thinkpad_t14s_gen_6_oled_dev);
 
@@ -40,6 +40,7 @@ static struct device lenovo_thinkpad_x13s_gen_1_dev = {
 	.dtb   = L"qcom\\sc8280xp-lenovo-thinkpad-x13s.dtb",
 	.hwids = lenovo_thinkpad_x13s_gen_1_hwids,
 
+	.prefetch = qcom_dpp_prefetch,
 	.dt_fixup = qcom_dt_set_dpp_mac,
 };
 DEVICE_DESC(lenovo_thinkpad_x13s_gen_1_dev);
@@ -30,6 +30,7 @@ static struct device microsoft_corporation_microsoft_surface_pro__11th_edition_d
 	.dtb   = L"qcom\\x1e80100-microsoft-denali.dtb", /* Tentative. */
 	.hwids = microsoft_corporation_microsoft_surface_pro__11th_edition_hwids,
 
+	.prefetch = qcom_dpp_prefetch,
 	.dt_fixup = qcom_dt_set_dpp_mac,
 };
 DEVICE_DESC(microsoft_corporation_microsoft_surface_pro__11th_edition_dev);
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * DTBs embedded into dtbloader.efi with "make EMBED_DTBS=dir".
+ *
+ * They are stored LZ4 compressed in the legacy frame format ("lz4 -l"),
+ * which is just a magic followed by size-prefixed blocks, so the decoder
+ * stays small and needs no allocations. The decoder only touches memory,
+ * so it can be run on another CPU while the BSP waits for the disk.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <string.h>
+#include <util.h>
+#include <embedded.h>
+
+#define LZ4_LEGACY_MAGIC	0x184c2102
+#define LZ4_MIN_MATCH		4
+
+static const CHAR16 *basename(const CHAR16 *name)
+{
+	const CHAR16 *ret = name;
+
+	for (; *name; ++name)
+		if (*name == L'\\')
+			ret = name + 1;
+
+	return ret;
+}
+
+/**
+ * embedded_dtb_find() - Look up an embedded DTB by name.
+ *
+ * Like on the ESP, falls back to matching just the file name.
+ *
+ * Returns: The DTB or NULL if it wasn't embedded.
+ */
+const struct embedded_dtb *embedded_dtb_find(CHAR16 *name)
+{
+	const struct embedded_dtb *dtb;
+
+	for (dtb = embedded_dtbs; dtb->name; ++dtb)
+		if (!StrCmp(dtb->name, name))
+			return dtb;
+
+	for (dtb = embedded_dtbs; dtb->name; ++dtb)
+		if (!StrCmp(basename(dtb->name), basename(name)))
+			return dtb;
+
+	return NULL;
+}
+
+static UINT32 get_le32(const UINT8 *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (UINT32)p[3] << 24;
+}
+
+static bool lz4_len(const UINT8 **src, const UINT8 *end, UINTN *len)
+{
+	UINT8 b;
+
+	do {
+		if (*src >= end)
+			return false;
+		b = *(*src)++;
+		*len += b;
+	} while (b == 255);
+
+	return true;
+}
+
+/**
+ * lz4_block() - Decompress one LZ4 block.
+ *
+ * Returns: Decompressed size or -1 if the block is corrupted or doesn't fit.
+ */
+static INTN lz4_block(const UINT8 *src, UINTN src_size, UINT8 *dst, UINTN dst_size)
+{
+	const UINT8 *end = src + src_size;
+	UINT8 *out = dst, *out_end = dst + dst_size;
+	const UINT8 *match;
+	UINTN len, offset;
+	UINT8 token;
+
+	while (src < end) {
+		token = *src++;
+
+		len = token >> 4;
+		if (len == 15 && !lz4_len(&src, end, &len))
+			return -1;
+
+		if (len > end - src || len > out_end - out)
+			return -1;
+
+		memcpy(out, src, len);
+		out += len;
+		src += len;
+
+		/* The last sequence only has literals. */
+		if (src == end)
+			break;
+
+		if (end - src < 2)
+			return -1;
+
+		offset = src[0] | src[1] << 8;
+		src += 2;
+
+		if (!offset || offset > out - dst)
+			return -1;
+
+		len = token & 15;
+		if (len == 15 && !lz4_len(&src, end, &len))
+			return -1;
+		len += LZ4_MIN_MATCH;
+
+		if (len > out_end - out)
+			return -1;
+
+		match = out - offset;
+		if (offset >= len) {
+			memcpy(out, match, len);
+			out += len;
+		} else {
+			/* Overlapping match repeats the last bytes. */
+			while (len--)
+				*out++ = *match++;
+		}
+	}
+
+	return out - dst;
+}
+
+/**
+ * embedded_dtb_decompress() - Unpack an embedded DTB.
+ * @dtb:   DTB to unpack.
+ * @buf:   Destination buffer.
+ * @size:  Size of @buf.
+ *
+ * Doesn't call into the firmware.
+ */
+EFI_STATUS embedded_dtb_decompress(const struct embedded_dtb *dtb, UINT8 *buf, UINTN size)
+{
+	const UINT8 *src = dtb->data, *end = dtb->data + dtb->size;
+	UINTN done = 0;
+	UINT32 block;
+	INTN ret;
+
+	if (dtb->dtb_size > size)
+		return EFI_BUFFER_TOO_SMALL;
+
+	while (end - src >= 4) {
+		block = get_le32(src);
+		src += 4;
+
+		/* Concatenated frames repeat the magic. */
+		if (block == LZ4_LEGACY_MAGIC)
+			continue;
+
+		if (block > end - src)
+			return EFI_LOAD_ERROR;
+
+		ret = lz4_block(src, block, buf + done, dtb->dtb_size - done);
+		if (ret < 0)
+			return EFI_LOAD_ERROR;
+
+		src += block;
+		done += ret;
+	}
+
+	return done == dtb->dtb_size ? EFI_SUCCESS : EFI_LOAD_ERROR;
+}
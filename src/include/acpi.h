@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <efi.h>
+
+#define ACPI_REGION_SYSTEM_MEMORY	0x00
+#define ACPI_REGION_SYSTEM_IO		0x01
+#define ACPI_REGION_ANY			0xff
+
+#pragma pack(1)
+typedef struct {
+	CHAR8  Signature[4];
+	UINT32 Length;
+	UINT8  Revision;
+	UINT8  Checksum;
+	CHAR8  OemId[6];
+	CHAR8  OemTableId[8];
+	UINT32 OemRevision;
+	UINT32 CreatorId;
+	UINT32 CreatorRevision;
+} ACPI_SDT_HEADER;
+#pragma pack()
+
+ACPI_SDT_HEADER *acpi_find_table(const char *signature, UINTN instance);
+EFI_STATUS acpi_find_opregion(const char *name, UINT8 space, UINT64 *base, UINT64 *len);
+void acpi_reset(void);
+
+#endif
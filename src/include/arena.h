@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <efi.h>
+
+/* Pages taken from the firmware at once, enough for a normal boot. */
+#define ARENA_CHUNK_PAGES	4
+
+void *arena_alloc(UINTN size);
+void arena_release(void);
+
+void *arena_get_variable(CHAR16 *name, EFI_GUID *guid, UINTN *size);
+EFI_HANDLE *arena_locate_handles(EFI_GUID *protocol, UINTN *count);
+EFI_FILE_INFO *arena_file_info(EFI_FILE_HANDLE file);
+
+#endif
@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <efi.h>
+
+#define BENCH_DEFAULT_ITERATIONS	100
+
+/**
+ * struct bench_stage - One benchmarked piece of work.
+ * @name:   Short name of the stage.
+ * @setup:  Optional untimed callback to run before every iteration.
+ * @run:    The work to be timed.
+ */
+struct bench_stage {
+	const CHAR16 *name;
+	EFI_STATUS (*setup)(void *ctx);
+	EFI_STATUS (*run)(void *ctx);
+};
+
+UINTN bench_iterations(EFI_HANDLE ImageHandle);
+EFI_STATUS bench_run(const struct bench_stage *stage, void *ctx, UINTN iterations);
+EFI_STATUS bench_memmove(UINTN iterations);
+
+#endif
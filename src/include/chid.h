@@ -3,6 +3,9 @@
 
 #include <efi.h>
 
+#define CHID_COUNT	15
+
 EFI_STATUS populate_board_hwids(EFI_GUID *hwids);
+EFI_STATUS populate_board_hwids_serial(EFI_GUID *hwids);
 
 #endif
@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef DEVDB_H
+#define DEVDB_H
+
+#include <efi.h>
+
+#include <device.h>
+
+/*
+ * Device database file, see devdb.c
+ *
+ * All fields are little-endian, offsets are from the start of the file.
+ * Strings are NUL-terminated UTF-16 and referenced by their byte offset
+ * in the string table, offset 0 is always an empty string.
+ */
+
+#define DEVDB_FILE_NAME		L"\\dtbloader\\devices.db"
+#define DEVDB_MAGIC		0x42445444	/* "DTDB" */
+#define DEVDB_VERSION		1
+
+/**
+ * struct devdb_header - Device database header.
+ * @magic:         DEVDB_MAGIC.
+ * @version:       DEVDB_VERSION.
+ * @size:          Size of the whole file.
+ * @device_count:  Number of entries in @devices.
+ * @chid_count:    Number of entries in @chids.
+ * @devices:       Offset of the struct devdb_device array.
+ * @chids:         Offset of the struct devdb_chid array.
+ * @strings:       Offset of the string table.
+ * @strings_size:  Size of the string table in bytes.
+ */
+struct devdb_header {
+	UINT32 magic;
+	UINT32 version;
+	UINT32 size;
+	UINT32 device_count;
+	UINT32 chid_count;
+	UINT32 devices;
+	UINT32 chids;
+	UINT32 strings;
+	UINT32 strings_size;
+};
+
+/**
+ * struct devdb_device - Device description.
+ * @name:      Pretty name string.
+ * @dtb:       DTB file name string.
+ * @fixup:     Name of the built-in device to take extra_match, prefetch
+ *             and dt_fixup callbacks from, or an empty string for none.
+ * @priority:  Lower values are tried first when several devices share a CHID.
+ */
+struct devdb_device {
+	UINT32 name;
+	UINT32 dtb;
+	UINT32 fixup;
+	UINT32 priority;
+};
+
+/**
+ * struct devdb_chid - CHID index entry, sorted by @chid bytes then @priority.
+ * @chid:      CHID of the device.
+ * @device:    Index of the device.
+ * @priority:  Copy of the device priority.
+ */
+struct devdb_chid {
+	EFI_GUID chid;
+	UINT32 device;
+	UINT32 priority;
+};
+
+EFI_STATUS devdb_load(EFI_HANDLE ImageHandle);
+struct device *devdb_lookup(EFI_GUID *chid);
+
+#endif
@@ -2,45 +2,99 @@
 #ifndef DEVICE_H
 #define DEVICE_H
 
+#include <stdbool.h>
 #include <efi.h>
 
+struct match_rule;
+
 /**
  * struct device - Device description
  * @name:         Pretty marketing name of this device.
  * @dtb:          Name of the DTB file.
  * @hwids:        zero-terminated array of hwid values.
+ * @rules:        MATCH_END terminated variant rules, see rules.h.
  * @extra_match:  Additional check to match the device.
+ * @prefetch:     Start slow I/O needed by @dt_fixup while the DTB is loading.
  * @dt_fixup:     Board specific DTB fixups callback.
+ * @dt_prune:     DT_PRUNE_* flags, nodes to drop before handing the DTB over.
  */
 struct device {
 	CHAR16 *name;
 	CHAR16 *dtb;
 	EFI_GUID *hwids;
+	const struct match_rule *rules;
 
 	EFI_STATUS (*extra_match)(struct device *dev);
+	EFI_STATUS (*prefetch)(struct device *dev);
 	EFI_STATUS (*dt_fixup)(struct device *dev, void* dtb);
+
+	UINT32 dt_prune;
 };
 
+#ifdef DTBLOADER_HOST
+/*
+ * Host builds are ELF which has no grouped sections,
+ * so use two separate sections instead.
+ */
+#define DEVICE_SECTION		__attribute__((section("dtbloader_devs")))
+#define DEVICE_SECTION_END	__attribute__((section("dtbloader_devs_end")))
+#else
+#define DEVICE_SECTION		__declspec(allocate(".devs$b"))
+#define DEVICE_SECTION_END	__declspec(allocate(".devs$c"))
+#endif
+
 /*
  * NOTE: This should be static but apparently clang is
  * bugged and ignores "used" attribute here... ehhh :(
  */
 #define DEVICE_DESC(dev) \
-	__declspec(allocate(".devs$b")) \
+	DEVICE_SECTION \
 	__attribute__((used)) \
 	struct device *_dtbloader_dev_##dev = (&dev)
 
 /*
  * Puts the description later in the array, useful for
  * "generic" match after more specific ones using
- * .extra_match callback.
+ * .rules or .extra_match callback.
  */
 #define DEVICE_DESC_END(dev) \
-	__declspec(allocate(".devs$c")) \
+	DEVICE_SECTION_END \
 	__attribute__((used)) \
 	struct device *_dtbloader_dev_##dev = (&dev)
 
+struct device **next_device(struct device **dev);
+
+/**
+ * for_each_device() - Iterate over all device descriptions in priority order.
+ * @dev:  struct device ** iterator.
+ */
+#define for_each_device(dev) \
+	for (dev = next_device(NULL); dev; dev = next_device(dev))
+
+/**
+ * struct match_result - How the device was matched.
+ * @chid:   Index of the matching CHID in the hwids array.
+ * @level:  Position of that CHID in the priority list, 0 is the most specific.
+ * @devdb:  The device came from the device database.
+ *
+ * Both indices are MATCH_NONE if nothing matched.
+ */
+struct match_result {
+	UINTN chid;
+	UINTN level;
+	bool devdb;
+};
+
+#define MATCH_NONE	((UINTN)-1)
+
+struct device *detect_device(void);
+void match_device_start(void);
 struct device *match_device(void);
+EFI_GUID *match_hwids(void);
+struct match_result *match_result(void);
+#ifdef DTBLOADER_HOST
+UINTN match_candidates(struct device **out, UINTN max);
+#endif
 
 #define MAC_ADDR_SIZE		6
 
@@ -48,6 +102,9 @@ EFI_STATUS dt_update_mac(void *dtb, const char * const compatibles[], unsigned n
 			 const char *prop, UINT8 mac[MAC_ADDR_SIZE]);
 
 /* qcom.c */
+EFI_STATUS qcom_dpp_prefetch(struct device *dev);
 EFI_STATUS qcom_dt_set_dpp_mac(struct device *dev, void *dtb);
+EFI_STATUS qcom_dpp_publish(struct device *dev);
+void qcom_dpp_unpublish(void);
 
 #endif
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef EMBEDDED_H
+#define EMBEDDED_H
+
+#include <efi.h>
+
+/**
+ * struct embedded_dtb - DTB linked into the image, see scripts/embed_dtbs.sh
+ * @name:      Name of the DTB, same as in struct device.
+ * @data:      LZ4 (legacy frame) compressed DTB.
+ * @size:      Size of @data.
+ * @dtb_size:  Size of the DTB once decompressed.
+ */
+struct embedded_dtb {
+	const CHAR16 *name;
+	const UINT8 *data;
+	UINT32 size;
+	UINT32 dtb_size;
+};
+
+/* Terminated by an entry with NULL name. */
+extern const struct embedded_dtb embedded_dtbs[];
+
+const struct embedded_dtb *embedded_dtb_find(CHAR16 *name);
+EFI_STATUS embedded_dtb_decompress(const struct embedded_dtb *dtb, UINT8 *buf, UINTN size);
+
+#endif
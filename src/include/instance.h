@@ -0,0 +1,18 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <efi.h>
+
+#include <device.h>
+
+/* Build number, newer builds take over from older ones, see instance.c */
+#ifndef DTBLOADER_VERSION
+#define DTBLOADER_VERSION	0
+#endif
+
+EFI_STATUS instance_find(void);
+void instance_set_dtb(EFI_PHYSICAL_ADDRESS dtb, UINTN pages);
+EFI_STATUS instance_publish(struct device *dev, EFI_HANDLE fixup_handle, void *fixup);
+
+#endif
@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef MP_H
+#define MP_H
+
+#include <stdbool.h>
+#include <efi.h>
+
+/**
+ * struct mp_job - Work that may run on another CPU.
+ * @fn:       Function to run. It must not call any firmware services.
+ * @arg:      Argument for @fn.
+ * @event:    Signalled by the firmware when the AP is done.
+ * @cpu:      Number of the AP running the job.
+ * @state:    Where the job is at, see enum mp_job_state.
+ */
+struct mp_job {
+	void (*fn)(void *arg);
+	void *arg;
+	EFI_EVENT event;
+	UINTN cpu;
+	int state;
+};
+
+enum mp_job_state {
+	MP_JOB_IDLE,
+	MP_JOB_DEFERRED,
+	MP_JOB_RUNNING,
+};
+
+void mp_job_start(struct mp_job *job, void (*fn)(void *arg), void *arg);
+void mp_job_wait(struct mp_job *job);
+
+#endif
@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef DPP_PROTOCOL_H
+#define DPP_PROTOCOL_H
+
+#include <efi.h>
+
+/*
+ * DTBLOADER_DPP_PROTOCOL
+ *
+ * Files from the Qualcomm DPP (device provisioning) partition, i.e. the
+ * WLAN.PROVISION and BT.PROVISION blobs with the MAC addresses. Installed
+ * by dtbloader on devices it reads DPP on, so that bootloaders and other
+ * EFI tools don't need to find and parse the partition themselves.
+ *
+ * The directory is read once. File contents are read on first use and
+ * then served from memory.
+ */
+
+#define DTBLOADER_DPP_PROTOCOL_GUID \
+	{ 0x2bdce123, 0x86d8, 0x43cf, { 0xb2, 0xd8, 0x74, 0x05, 0x9f, 0xdc, 0xb0, 0x31 } }
+#define DTBLOADER_DPP_PROTOCOL_REVISION 0x00010000
+
+#define DTBLOADER_DPP_NAME_LEN	49
+
+typedef struct _DTBLOADER_DPP_PROTOCOL DTBLOADER_DPP_PROTOCOL;
+
+typedef struct {
+	CHAR16    Name[DTBLOADER_DPP_NAME_LEN + 1];
+	CHAR16    Vendor[DTBLOADER_DPP_NAME_LEN + 1];	/* QCOM or OEM */
+	UINT32    Size;
+} DTBLOADER_DPP_FILE_INFO;
+
+/*
+ * Get all files on the partition. The array is owned by dtbloader and is
+ * valid as long as the protocol is installed.
+ */
+typedef EFI_STATUS
+(EFIAPI *DTBLOADER_DPP_LIST) (
+		IN  DTBLOADER_DPP_PROTOCOL    *This,
+		OUT UINTN                     *Count,
+		OUT DTBLOADER_DPP_FILE_INFO   **Files
+		);
+
+/*
+ * Read a file by name (case insensitive). If @BufferSize is too small it's
+ * set to the file size and EFI_BUFFER_TOO_SMALL is returned.
+ */
+typedef EFI_STATUS
+(EFIAPI *DTBLOADER_DPP_READ) (
+		IN     DTBLOADER_DPP_PROTOCOL *This,
+		IN     CHAR16                 *Name,
+		IN OUT UINTN                  *BufferSize,
+		OUT    VOID                   *Buffer
+		);
+
+typedef struct _DTBLOADER_DPP_PROTOCOL {
+	UINT64                Revision;
+	DTBLOADER_DPP_LIST    List;
+	DTBLOADER_DPP_READ    Read;
+} DTBLOADER_DPP_PROTOCOL;
+
+#endif
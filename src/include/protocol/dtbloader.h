@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef DTBLOADER_PROTOCOL_H
+#define DTBLOADER_PROTOCOL_H
+
+#include <efi.h>
+
+/*
+ * DTBLOADER_PROTOCOL
+ *
+ * Private protocol installed by every running dtbloader so that another
+ * copy of it (i.e. loaded both from Driver#### and by systemd-boot) can
+ * find the first one instead of doing all the work again.
+ *
+ * Only Revision and Version are guaranteed to be at the same place in
+ * every revision, the rest may only be used if the major revision matches.
+ */
+
+#define DTBLOADER_PROTOCOL_GUID \
+	{ 0xf273114b, 0x8cb4, 0x471c, { 0xa3, 0x1c, 0xf0, 0x3d, 0x48, 0x94, 0xb2, 0x14 } }
+#define DTBLOADER_PROTOCOL_REVISION 0x00010000
+
+#define DTBLOADER_HWIDS_COUNT 15
+
+typedef struct _DTBLOADER_PROTOCOL DTBLOADER_PROTOCOL;
+
+/*
+ * Called by a newer instance taking over. Uninstalls the fixup protocol,
+ * this protocol and DTBLOADER_DPP_PROTOCOL. On failure all of them are
+ * left installed. The DTB is left in place either way, it's up to the
+ * caller to free it once replaced, or to take it over on success.
+ */
+typedef EFI_STATUS
+(EFIAPI *DTBLOADER_RELEASE) (
+		IN DTBLOADER_PROTOCOL *This
+		);
+
+typedef struct _DTBLOADER_PROTOCOL {
+	UINT64                  Revision;
+	UINT64                  Version;
+	CHAR16                  *DeviceName;
+	CHAR16                  *DtbName;
+	EFI_GUID                Hwids[DTBLOADER_HWIDS_COUNT];
+	EFI_PHYSICAL_ADDRESS    Dtb;
+	UINTN                   DtbPages;
+	EFI_HANDLE              FixupHandle;
+	VOID                    *Fixup;
+	DTBLOADER_RELEASE       Release;
+} DTBLOADER_PROTOCOL;
+
+#endif
@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef DTBLOADER_MATCH_H
+#define DTBLOADER_MATCH_H
+
+#include <efi.h>
+
+/*
+ * DTBLOADER_MATCH_TABLE
+ *
+ * Result of the device detection done by dtbloader, so that bootloaders
+ * and the OS don't need to hash SMBIOS strings again to get the CHIDs.
+ *
+ * Installed as a configuration table and as the volatile DtbloaderMatch
+ * variable, both under DTBLOADER_MATCH_TABLE_GUID. With efivarfs the
+ * variable is at /sys/firmware/efi/efivars/DtbloaderMatch-<guid>, see
+ * host/matchinfo.c for a decoder.
+ *
+ * Fields are only appended in newer minor revisions, Size tells how much
+ * of the structure is valid.
+ */
+
+#define DTBLOADER_MATCH_TABLE_GUID \
+	{ 0xf8a6489e, 0x2fde, 0x41ac, { 0x95, 0x25, 0x13, 0x94, 0x2b, 0x39, 0x4f, 0x41 } }
+#define DTBLOADER_MATCH_TABLE_REVISION	0x00010000
+
+#define DTBLOADER_MATCH_VARIABLE	L"DtbloaderMatch"
+
+#define DTBLOADER_MATCH_CHID_COUNT	15
+#define DTBLOADER_MATCH_NONE		0xff
+
+/* Flags */
+#define DTBLOADER_MATCH_FOUND		(1 << 0)	/* A device was matched. */
+#define DTBLOADER_MATCH_DEVDB		(1 << 1)	/* ...from devices.db on the ESP. */
+
+typedef struct {
+	UINT32    Revision;
+	UINT32    Size;
+	UINT64    Version;                                 /* dtbloader build number */
+	UINT32    Flags;
+	UINT8     MatchedChid;                             /* Index in Chids or DTBLOADER_MATCH_NONE */
+	UINT8     MatchedLevel;                            /* 0 is the most specific CHID type */
+	UINT8     Reserved[2];
+	EFI_GUID  Chids[DTBLOADER_MATCH_CHID_COUNT];       /* By CHID type, all-zero if not computed */
+	CHAR16    DeviceName[64];
+	CHAR16    DtbName[128];
+} DTBLOADER_MATCH_TABLE;
+
+#endif
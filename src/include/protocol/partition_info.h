@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef PARTITION_INFO_H
+#define PARTITION_INFO_H
+
+#include <efi.h>
+
+/*
+ * EFI_PARTITION_INFO_PROTOCOL
+ *
+ * Documented in the UEFI spec, but not provided by gnu-efi.
+ */
+
+#define EFI_PARTITION_INFO_PROTOCOL_GUID \
+  { 0x8cf2f62c, 0xbc9b, 0x4821, {0x80, 0x8d, 0xec, 0x9e, 0xc4, 0x21, 0xa1, 0xa0} }
+
+typedef struct {
+  EFI_GUID     PartitionTypeGUID;
+  EFI_GUID     UniquePartitionGUID;
+  EFI_LBA      StartingLBA;
+  EFI_LBA      EndingLBA;
+  UINT64       Attributes;
+  CHAR16       PartitionName[36];
+} __attribute__((packed)) EFI_PARTITION_ENTRY;
+
+#define EFI_PARTITION_INFO_PROTOCOL_REVISION 0x0001000
+#define PARTITION_TYPE_OTHER 0x00
+#define PARTITION_TYPE_MBR 0x01
+#define PARTITION_TYPE_GPT 0x02
+
+typedef struct {
+
+  UINT32         Revision;
+  UINT32         Type;
+  UINT8          System;
+  UINT8          Reserved[7];
+  union {
+   MBR_PARTITION_RECORD Mbr;
+   EFI_PARTITION_ENTRY Gpt;
+  } Info;
+} __attribute__((packed)) EFI_PARTITION_INFO_PROTOCOL;
+
+#endif
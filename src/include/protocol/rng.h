@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef RNG_PROTOCOL_H
+#define RNG_PROTOCOL_H
+
+#include <efi.h>
+
+/*
+ * EFI_RNG_PROTOCOL
+ *
+ * Documented in the UEFI spec (37.5), older gnu-efi doesn't provide it.
+ */
+
+#ifndef EFI_RNG_PROTOCOL_GUID
+#define EFI_RNG_PROTOCOL_GUID \
+	{ 0x3152bca5, 0xeade, 0x433d, { 0x86, 0x2e, 0xc0, 0x1c, 0xdc, 0x29, 0x1f, 0x44 } }
+
+typedef EFI_GUID EFI_RNG_ALGORITHM;
+
+typedef struct _EFI_RNG_PROTOCOL EFI_RNG_PROTOCOL;
+
+typedef EFI_STATUS
+(EFIAPI *EFI_RNG_GET_INFO) (
+		IN     EFI_RNG_PROTOCOL   *This,
+		IN OUT UINTN              *RNGAlgorithmListSize,
+		OUT    EFI_RNG_ALGORITHM  *RNGAlgorithmList
+		);
+
+typedef EFI_STATUS
+(EFIAPI *EFI_RNG_GET_RNG) (
+		IN  EFI_RNG_PROTOCOL   *This,
+		IN  EFI_RNG_ALGORITHM  *RNGAlgorithm, OPTIONAL
+		IN  UINTN              RNGValueLength,
+		OUT UINT8              *RNGValue
+		);
+
+typedef struct _EFI_RNG_PROTOCOL {
+	EFI_RNG_GET_INFO  GetInfo;
+	EFI_RNG_GET_RNG   GetRNG;
+} EFI_RNG_PROTOCOL;
+#endif
+
+#endif
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef PRUNE_H
+#define PRUNE_H
+
+#include <efi.h>
+
+/*
+ * Remove status = "disabled" subtrees no phandle points into. Implies
+ * DT_PRUNE_OVERLAY, since __symbols__ may still point at them.
+ */
+#define DT_PRUNE_DISABLED	(1 << 0)
+/* Remove __symbols__, __fixups__ and __local_fixups__. */
+#define DT_PRUNE_OVERLAY	(1 << 1)
+
+EFI_STATUS dt_prune(void *dtb, UINT32 flags);
+
+#endif
@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef PUBLISH_H
+#define PUBLISH_H
+
+#include <efi.h>
+
+#include <device.h>
+
+EFI_STATUS publish_match(struct device *dev);
+
+#endif
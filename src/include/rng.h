@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef RNG_H
+#define RNG_H
+
+#include <efi.h>
+
+/* Size of /chosen/rng-seed, same as the Linux EFI stub uses. */
+#define RNG_SEED_SIZE		64
+
+EFI_STATUS rng_get_bytes(UINT8 *buf, UINTN len);
+EFI_STATUS rng_dt_fixup(void *dtb);
+
+#endif
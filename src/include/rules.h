@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdbool.h>
+#include <efi.h>
+
+struct device;
+
+enum match_rule_kind {
+	MATCH_RULE_END = 0,
+	MATCH_RULE_SMBIOS_EQUALS,
+	MATCH_RULE_SMBIOS_CONTAINS,
+	MATCH_RULE_OEM_STRING,
+	MATCH_RULE_MEMORY_MB,
+	MATCH_RULE_ACPI_REGION_U8,
+};
+
+/**
+ * struct match_rule - Declarative variant predicate.
+ * @kind:    enum match_rule_kind.
+ * @type:    SMBIOS structure type.
+ * @offset:  Offset of the SMBIOS string field or of the byte in the ACPI region.
+ * @str:     Expected string, OEM string or ACPI OperationRegion name.
+ * @min:     Lowest accepted value.
+ * @max:     Highest accepted value.
+ *
+ * Use the MATCH_* macros below to fill it. The rules of a device are a
+ * MATCH_RULE_END terminated array and all of them have to pass.
+ */
+struct match_rule {
+	UINT8 kind;
+	UINT8 type;
+	UINT16 offset;
+	const char *str;
+	UINT64 min;
+	UINT64 max;
+};
+
+/* The string at @off of the first SMBIOS structure of @stype is @s. */
+#define MATCH_SMBIOS_EQUALS(stype, off, s) \
+	{ .kind = MATCH_RULE_SMBIOS_EQUALS, .type = (stype), .offset = (off), .str = (s) }
+
+/* The string at @off of the first SMBIOS structure of @stype contains @s. */
+#define MATCH_SMBIOS_CONTAINS(stype, off, s) \
+	{ .kind = MATCH_RULE_SMBIOS_CONTAINS, .type = (stype), .offset = (off), .str = (s) }
+
+/* Any of the type 11 OEM strings is @s. */
+#define MATCH_OEM_STRING(s) \
+	{ .kind = MATCH_RULE_OEM_STRING, .str = (s) }
+
+/* Total installed memory is within [@lo, @hi] MiB. */
+#define MATCH_MEMORY_MB(lo, hi) \
+	{ .kind = MATCH_RULE_MEMORY_MB, .min = (lo), .max = (hi) }
+
+/* Byte at @off of the SystemMemory OperationRegion @name is @val. */
+#define MATCH_ACPI_REGION_U8(name, off, val) \
+	{ .kind = MATCH_RULE_ACPI_REGION_U8, .str = (name), .offset = (off), \
+	  .min = (val), .max = (val) }
+
+#define MATCH_END	{ .kind = MATCH_RULE_END }
+
+void rules_compile(EFI_GUID *hwids, UINTN count);
+void rules_reset(void);
+bool match_rules(struct device *dev);
+
+#endif
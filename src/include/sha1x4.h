@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef SHA1X4_H
+#define SHA1X4_H
+
+#include <efi.h>
+
+#define SHA1X4_LANES		4
+#define SHA1_DIGEST_SIZE	20
+
+void sha1x4(const UINT8 *const msg[SHA1X4_LANES], const UINTN len[SHA1X4_LANES],
+	    UINT8 digest[SHA1X4_LANES][SHA1_DIGEST_SIZE]);
+
+#endif
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef SMBIOS_H
+#define SMBIOS_H
+
+#include <efi.h>
+
+#define SMBIOS_TYPE_SYSTEM_INFORMATION		1
+#define SMBIOS_TYPE_BASEBOARD_INFORMATION	2
+#define SMBIOS_TYPE_SYSTEM_ENCLOSURE		3
+#define SMBIOS_TYPE_OEM_STRINGS			11
+#define SMBIOS_TYPE_MEMORY_DEVICE		17
+#define SMBIOS_TYPE_END_OF_TABLE		127
+
+/*
+ * gnu-efi doesn't have the full definition for this sadly...
+ */
+#pragma pack(1)
+typedef struct {
+	SMBIOS_HEADER   Hdr;
+	SMBIOS_STRING   Manufacturer;
+	SMBIOS_STRING   ProductName;
+	SMBIOS_STRING   Version;
+	SMBIOS_STRING   SerialNumber;
+	EFI_GUID        Uuid;
+	UINT8           WakeUpType;
+	SMBIOS_STRING   SKUNumber;
+	SMBIOS_STRING   Family;
+} SMBIOS_TYPE1_X;
+#pragma pack()
+
+SMBIOS_HEADER *smbios_find(UINT8 type, UINTN instance);
+CHAR8 *smbios_string(SMBIOS_HEADER *hdr, UINT8 nr);
+CHAR8 *smbios_get_string(UINT8 type, UINTN offset);
+void smbios_reset(void);
+
+#endif
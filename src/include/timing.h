@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <efi.h>
+
+#define TIMING_MAX_STAGES	32
+
+/**
+ * struct timing_stage - Timestamps of one stage of work.
+ * @name:   Short name of the stage.
+ * @start:  Timer value when the stage has started.
+ * @end:    Timer value when the stage has ended, 0 if never ended.
+ */
+struct timing_stage {
+	const CHAR16 *name;
+	UINT64 start;
+	UINT64 end;
+};
+
+extern struct timing_stage timing_stages[TIMING_MAX_STAGES];
+extern int timing_count;
+
+UINT64 timer_ticks(void);
+UINT64 timer_freq(void);
+UINT64 timer_us(UINT64 ticks);
+
+int timing_begin(const CHAR16 *name);
+void timing_end(int stage);
+void timing_report(void);
+
+#endif
@@ -20,9 +20,20 @@ void FileClose(EFI_FILE_HANDLE FileHandle);
 EFI_STATUS AllocateZeroPages(UINT64 page_count, EFI_PHYSICAL_ADDRESS *addr);
 void FreePages(EFI_PHYSICAL_ADDRESS addr, UINT64 page_count);
 
+bool CanWait(void);
+EFI_STATUS WaitEvent(EFI_EVENT event);
+
 CHAR16 *StrrChr(CHAR16 *str, CHAR16 ch);
 
+/*
+ * Vendor GUID of the variables owned by dtbloader. Firmware may refuse
+ * unknown variables under EFI_GLOBAL_VARIABLE (i.e. EDK2 VarCheckUefiLib).
+ */
+#define DTBLOADER_VARIABLE_GUID \
+	{ 0x67c1b52f, 0xb94c, 0x42ca, { 0xb1, 0x6f, 0x6d, 0x61, 0x3b, 0x8e, 0xb4, 0x14 } }
+
 bool SecureBootEnabled(void);
+EFI_STATUS ConfirmHashChange(CHAR16 *var, EFI_GUID *guid, EFI_SHA1_HASH *hash, CHAR16 *prompt);
 
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof((x)[0]))
 
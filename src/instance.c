@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Detection of other running dtbloader copies.
+ *
+ * dtbloader may get loaded more than once, i.e. from a Driver#### option
+ * and then again from the systemd-boot drivers directory. Every instance
+ * publishes DTBLOADER_PROTOCOL with its state. A later instance that finds
+ * it exits right away, unless it's a newer build, in which case it does the
+ * work itself and then asks the old one to release its fixup protocol and
+ * frees the old DTB, so only one of each stays installed.
+ *
+ * The handover happens once the new instance has installed everything,
+ * nothing is deferred past its entry point. If the old instance can't
+ * release, it keeps its protocols and DTB and both stay installed.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <util.h>
+#include <device.h>
+#include <instance.h>
+
+#include <protocol/dtbloader.h>
+#include <protocol/dt_fixup.h>
+
+static EFI_STATUS EFIAPI instance_release(DTBLOADER_PROTOCOL *this);
+
+static DTBLOADER_PROTOCOL instance = {
+	.Revision = DTBLOADER_PROTOCOL_REVISION,
+	.Version = DTBLOADER_VERSION,
+	.Release = instance_release,
+};
+
+static EFI_HANDLE instance_handle;
+static DTBLOADER_PROTOCOL *previous;
+
+/**
+ * instance_find() - Look for a dtbloader that is already running.
+ *
+ * Returns: EFI_ALREADY_STARTED if this instance should not do anything,
+ * EFI_SUCCESS otherwise.
+ */
+EFI_STATUS instance_find(void)
+{
+	EFI_GUID guid = DTBLOADER_PROTOCOL_GUID;
+	DTBLOADER_PROTOCOL *other;
+	EFI_STATUS status;
+
+	status = uefi_call_wrapper(BS->LocateProtocol, 3, &guid, NULL, (void **)&other);
+	if (EFI_ERROR(status))
+		return EFI_SUCCESS;
+
+	if (other->Revision >> 16 != DTBLOADER_PROTOCOL_REVISION >> 16 ||
+	    other->Version >= DTBLOADER_VERSION) {
+		Dbg(L"dtbloader %ld is already running, exiting\n", other->Version);
+		return EFI_ALREADY_STARTED;
+	}
+
+	Dbg(L"Taking over from dtbloader %ld\n", other->Version);
+	previous = other;
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * instance_set_dtb() - Record the DTB we've installed.
+ * @dtb:    Installed DTB.
+ * @pages:  Size of the DTB buffer.
+ *
+ * The DTB of the instance we're taking over is no longer referenced by the
+ * config table at this point, so it's freed here.
+ */
+void instance_set_dtb(EFI_PHYSICAL_ADDRESS dtb, UINTN pages)
+{
+	instance.Dtb = dtb;
+	instance.DtbPages = pages;
+
+	if (previous && previous->Dtb) {
+		FreePages(previous->Dtb, previous->DtbPages);
+		previous->Dtb = 0;
+	}
+}
+
+/**
+ * instance_publish() - Install DTBLOADER_PROTOCOL and release the old instance.
+ * @dev:           Matched device.
+ * @fixup_handle:  Handle with our EFI_DT_FIXUP_PROTOCOL.
+ * @fixup:         Our EFI_DT_FIXUP_PROTOCOL.
+ */
+EFI_STATUS instance_publish(struct device *dev, EFI_HANDLE fixup_handle, void *fixup)
+{
+	EFI_GUID guid = DTBLOADER_PROTOCOL_GUID;
+	EFI_GUID *hwids = match_hwids();
+	EFI_STATUS status;
+
+	instance.DeviceName = dev->name;
+	instance.DtbName = dev->dtb;
+	instance.FixupHandle = fixup_handle;
+	instance.Fixup = fixup;
+	if (hwids)
+		CopyMem(instance.Hwids, hwids, sizeof(instance.Hwids));
+
+	if (previous) {
+		status = uefi_call_wrapper(previous->Release, 1, previous);
+		if (EFI_ERROR(status)) {
+			Print(L"Failed to release dtbloader %ld: %r\n", previous->Version, status);
+		} else if (!instance.Dtb && previous->Dtb) {
+			/*
+			 * We didn't have a DTB to replace the old one with, so it
+			 * stays installed and is ours to free from now on.
+			 */
+			instance.Dtb = previous->Dtb;
+			instance.DtbPages = previous->DtbPages;
+		}
+		previous = NULL;
+	}
+
+	return uefi_call_wrapper(BS->InstallProtocolInterface, 4, &instance_handle, &guid,
+				 EFI_NATIVE_INTERFACE, &instance);
+}
+
+static EFI_STATUS EFIAPI instance_release(DTBLOADER_PROTOCOL *this)
+{
+	EFI_GUID fixup_guid = EFI_DT_FIXUP_PROTOCOL_GUID;
+	EFI_GUID guid = DTBLOADER_PROTOCOL_GUID;
+	EFI_STATUS status;
+
+	status = uefi_call_wrapper(BS->UninstallProtocolInterface, 3, this->FixupHandle,
+				   &fixup_guid, this->Fixup);
+	if (EFI_ERROR(status))
+		return status;
+
+	status = uefi_call_wrapper(BS->UninstallProtocolInterface, 3, instance_handle,
+				   &guid, this);
+	if (EFI_ERROR(status)) {
+		/* Stay fully installed, the caller will run alongside us. */
+		uefi_call_wrapper(BS->InstallProtocolInterface, 4, &this->FixupHandle,
+				  &fixup_guid, EFI_NATIVE_INTERFACE, this->Fixup);
+		return status;
+	}
+
+	/* The newer instance installs its own. */
+	qcom_dpp_unpublish();
+
+	return EFI_SUCCESS;
+}
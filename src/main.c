@@ -9,9 +9,23 @@
 
 #include <util.h>
 #include <device.h>
+#include <chid.h>
+#include <timing.h>
+#include <bench.h>
+#include <mp.h>
+#include <instance.h>
+#include <embedded.h>
+#include <devdb.h>
+#include <arena.h>
+#include <publish.h>
+#include <rng.h>
+#include <prune.h>
 
 #include <protocol/dt_fixup.h>
 
+#define DTB_MAX_SIZE	(1 * 1024 * 1024)
+#define DTB_PAGES	EFI_SIZE_TO_PAGES(DTB_MAX_SIZE)
+
 static const CHAR16 *dtb_locations[] = {
 	L"\\dtbloader\\dtbs\\",
 	L"\\dtbs\\",
@@ -60,47 +74,165 @@ static EFI_FILE_HANDLE open_dtb(EFI_FILE_HANDLE volume, CHAR16 *name)
 	return dtb_file;
 }
 
-static EFI_STATUS load_dtb(EFI_HANDLE ImageHandle, struct device *dev, UINT8 **dtb_ret)
+/**
+ * struct dtb_load - DTB file read in flight.
+ * @file:     Open DTB file, NULL if the DTB is embedded.
+ * @phys:     Buffer the DTB is read into, DTB_MAX_SIZE long.
+ * @token:    Token of the async read, @token.Event is NULL if it was synchronous.
+ * @status:   Result of the synchronous read or the decompression.
+ * @embedded: Embedded DTB being decompressed by @job.
+ * @job:      Decompression job.
+ */
+struct dtb_load {
+	EFI_FILE_HANDLE file;
+	EFI_PHYSICAL_ADDRESS phys;
+	EFI_FILE_IO_TOKEN token;
+	EFI_STATUS status;
+#ifdef EMBED_DTBS
+	const struct embedded_dtb *embedded;
+	struct mp_job job;
+#endif
+};
+
+#ifdef EMBED_DTBS
+static void decompress_dtb(void *arg)
+{
+	struct dtb_load *ld = arg;
+
+	ld->status = embedded_dtb_decompress(ld->embedded, (UINT8 *)ld->phys, DTB_MAX_SIZE);
+}
+
+/**
+ * load_embedded_dtb_start() - Start unpacking the DTB if it's built in.
+ *
+ * Returns: EFI_NOT_FOUND if the DTB wasn't embedded.
+ */
+static EFI_STATUS load_embedded_dtb_start(struct device *dev, struct dtb_load *ld)
+{
+	EFI_STATUS status;
+
+	ld->file = NULL;
+	ld->embedded = embedded_dtb_find(dev->dtb);
+	if (!ld->embedded)
+		return EFI_NOT_FOUND;
+
+	Dbg(L"  Found embedded %s\n", ld->embedded->name);
+
+	status = uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiACPIReclaimMemory, DTB_PAGES, &ld->phys);
+	if (EFI_ERROR(status)) {
+		Print(L"Failed to allocate memory: %r\n", status);
+		return status;
+	}
+
+	ld->token.Event = NULL;
+	mp_job_start(&ld->job, decompress_dtb, ld);
+
+	return EFI_SUCCESS;
+}
+#endif
+
+/**
+ * load_dtb_start() - Open the DTB and start reading it.
+ *
+ * Uses ReadEx() when the file system supports it so the caller can do
+ * something else until load_dtb_finish().
+ */
+static EFI_STATUS load_dtb_start(EFI_HANDLE ImageHandle, struct device *dev, struct dtb_load *ld)
 {
 	EFI_STATUS status;
-	int ret;
 
 	Dbg(L"Installing DTB: %s\n", dev->dtb);
 
+#ifdef EMBED_DTBS
+	status = load_embedded_dtb_start(dev, ld);
+	if (status != EFI_NOT_FOUND)
+		return status;
+#endif
+
 	EFI_FILE_HANDLE volume = GetVolume(ImageHandle);
 	if (!volume) {
 		Print(L"Cant open volume\n");
 		return EFI_INVALID_PARAMETER;
 	}
 
-	EFI_FILE_HANDLE dtb_file = open_dtb(volume, dev->dtb);
-	if (!dtb_file) {
+	ld->file = open_dtb(volume, dev->dtb);
+	if (!ld->file) {
 		Print(L"Cant open the file\n");
 		return EFI_NOT_FOUND;
 	}
 
-	EFI_PHYSICAL_ADDRESS dtb_phys;
-	UINT64 dtb_max_sz = 1 * 1024 * 1024;
-	UINT64 dtb_pages  = dtb_max_sz / 4096;
-
 	/* The spec mandates using "ACPI" memory type for any configuration tables like dtb */
-	status = uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiACPIReclaimMemory, dtb_pages, &dtb_phys);
+	status = uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiACPIReclaimMemory, DTB_PAGES, &ld->phys);
 	if (EFI_ERROR(status)) {
 		Print(L"Failed to allocate memory: %r\n", status);
+		FileClose(ld->file);
 		return status;
 	}
 
-	UINT8 *dtb    = (UINT8 *)(dtb_phys);
-	UINT64 dtb_sz = FileSize(dtb_file);
+	UINT64 dtb_sz = FileSize(ld->file);
 
-	if (dtb_sz > 1 * 1024 * 1024) {
+	if (dtb_sz > DTB_MAX_SIZE) {
 		Print(L"File too big!\n");
 		status = EFI_BUFFER_TOO_SMALL;
 		goto error;
 	}
 
-	FileRead(dtb_file, dtb, dtb_sz);
-	FileClose(dtb_file);
+	ld->token.Event = NULL;
+	ld->token.BufferSize = dtb_sz;
+	ld->token.Buffer = (UINT8 *)ld->phys;
+	ld->status = EFI_SUCCESS;
+
+	if (ld->file->Revision >= EFI_FILE_PROTOCOL_REVISION2 && CanWait()) {
+		status = uefi_call_wrapper(BS->CreateEvent, 5, 0, TPL_CALLBACK, NULL, NULL, &ld->token.Event);
+		if (!EFI_ERROR(status)) {
+			status = uefi_call_wrapper(ld->file->ReadEx, 2, ld->file, &ld->token);
+			if (!EFI_ERROR(status))
+				return EFI_SUCCESS;
+
+			uefi_call_wrapper(BS->CloseEvent, 1, ld->token.Event);
+			ld->token.Event = NULL;
+			ld->token.BufferSize = dtb_sz;
+		}
+	}
+
+	FileRead(ld->file, ld->token.Buffer, dtb_sz);
+	return EFI_SUCCESS;
+
+error:
+	FileClose(ld->file);
+	FreePages(ld->phys, DTB_PAGES);
+	return status;
+}
+
+/**
+ * load_dtb_finish() - Wait for the DTB read and validate it.
+ */
+static EFI_STATUS load_dtb_finish(struct dtb_load *ld, UINT8 **dtb_ret)
+{
+	UINT8 *dtb = (UINT8 *)ld->phys;
+	EFI_STATUS status = EFI_SUCCESS;
+	int ret;
+
+#ifdef EMBED_DTBS
+	if (ld->embedded) {
+		mp_job_wait(&ld->job);
+		status = ld->status;
+	}
+#endif
+
+	if (ld->token.Event) {
+		WaitEvent(ld->token.Event);
+		uefi_call_wrapper(BS->CloseEvent, 1, ld->token.Event);
+		status = ld->token.Status;
+	}
+
+	if (ld->file)
+		FileClose(ld->file);
+
+	if (EFI_ERROR(status)) {
+		Print(L"Failed to read the dtb: %r\n", status);
+		goto error;
+	}
 
 	ret = fdt_check_header(dtb);
 	if (ret) {
@@ -109,7 +241,7 @@ static EFI_STATUS load_dtb(EFI_HANDLE ImageHandle, struct device *dev, UINT8 **d
 		goto error;
 	}
 
-	ret = fdt_open_into(dtb, dtb, dtb_max_sz);
+	ret = fdt_open_into(dtb, dtb, DTB_MAX_SIZE);
 	if (ret) {
 		Print(L"fdt open failed: %d\n", ret);
 		status = EFI_LOAD_ERROR;
@@ -121,15 +253,37 @@ static EFI_STATUS load_dtb(EFI_HANDLE ImageHandle, struct device *dev, UINT8 **d
 	return EFI_SUCCESS;
 
 error:
-	FreePages(dtb_phys, dtb_pages);
+	FreePages(ld->phys, DTB_PAGES);
 	return status;
+}
 
+static EFI_STATUS load_dtb(EFI_HANDLE ImageHandle, struct device *dev, UINT8 **dtb_ret)
+{
+	struct dtb_load ld;
+	EFI_STATUS status;
+
+	status = load_dtb_start(ImageHandle, dev, &ld);
+	if (EFI_ERROR(status))
+		return status;
+
+	return load_dtb_finish(&ld, dtb_ret);
 }
 
-static EFI_STATUS finalize_dtb(UINT8 *dtb)
+static EFI_STATUS finalize_dtb(struct device *dev, UINT8 *dtb)
 {
+	EFI_STATUS status;
 	int ret;
 
+	/*
+	 * Pruning only makes the DTB smaller. Nodes are deleted one at a time
+	 * so the tree is still valid after a failure, hand it over as is.
+	 */
+	if (dev->dt_prune) {
+		status = dt_prune(dtb, dev->dt_prune);
+		if (EFI_ERROR(status))
+			Print(L"fdt prune failed, continuing: %r\n", status);
+	}
+
 	ret = fdt_pack(dtb);
 	if (ret) {
 		Print(L"fdt pack failed: %d\n", ret);
@@ -143,6 +297,11 @@ static EFI_STATUS apply_dt_fixups(struct device *dev, void *dtb)
 {
 	EFI_STATUS status;
 
+	/* Missing entropy only makes the kernel wait, don't fail the boot over it. */
+	status = rng_dt_fixup(dtb);
+	if (EFI_ERROR(status))
+		Dbg(L"Failed to add rng seed: %r\n", status);
+
 	if (dev->dt_fixup) {
 		status = dev->dt_fixup(dev, dtb);
 		if (EFI_ERROR(status)) {
@@ -153,6 +312,19 @@ static EFI_STATUS apply_dt_fixups(struct device *dev, void *dtb)
 	return EFI_SUCCESS;
 }
 
+struct dtb_hash_job {
+	void *dtb;
+	UINTN size;
+	EFI_SHA1_HASH hash;
+};
+
+static void hash_dtb(void *arg)
+{
+	struct dtb_hash_job *job = arg;
+
+	SHA1((void*)&job->hash, job->dtb, job->size);
+}
+
 /*
  * NOTE: The security model for now is pretty simple.
  * We just check if the dtb hash has changed since the
@@ -160,44 +332,60 @@ static EFI_STATUS apply_dt_fixups(struct device *dev, void *dtb)
  */
 static EFI_STATUS check_dtb_hash(void *dtb)
 {
-	EFI_STATUS status;
-	UINTN dtb_size = fdt_totalsize(dtb);
-	EFI_SHA1_HASH *old_hash, new_hash;
+	struct dtb_hash_job hash_job = { .dtb = dtb, .size = fdt_totalsize(dtb) };
+	EFI_SHA1_HASH *old_hash;
 	bool hashes_match = false;
+	struct mp_job job;
 
 	if (!SecureBootEnabled())
 		return EFI_SUCCESS;
 
-	old_hash = LibGetVariable(L"DtbloaderDtbHash", &gEfiGlobalVariableGuid);
+	_Static_assert(sizeof(hash_job.hash) == 20, "");
 
-	_Static_assert(sizeof(new_hash) == 20, "");
-	SHA1((void*)&new_hash, (void*)dtb, dtb_size);
+	/* Hash on another core, if there is one, while we read the old one. */
+	mp_job_start(&job, hash_dtb, &hash_job);
 
-	if (old_hash) {
-		hashes_match = !CompareMem(old_hash, &new_hash, sizeof(*old_hash));
-		FreePool(old_hash);
-	}
+	old_hash = arena_get_variable(L"DtbloaderDtbHash", &gEfiGlobalVariableGuid, NULL);
 
-	if (hashes_match)
-		return EFI_SUCCESS;
+	mp_job_wait(&job);
 
-	Print(L"%es\n", L"(dtbloader) DTB has changed! Press any key to confirm...");
-	Pause();
+	if (old_hash)
+		hashes_match = !CompareMem(old_hash, &hash_job.hash, sizeof(*old_hash));
 
-	status = LibSetNVVariable(L"DtbloaderDtbHash", &gEfiGlobalVariableGuid, sizeof(new_hash), &new_hash);
-	if (EFI_ERROR(status))
-		return status;
+	if (hashes_match)
+		return EFI_SUCCESS;
 
-	return EFI_SUCCESS;
+	return ConfirmHashChange(L"DtbloaderDtbHash", &gEfiGlobalVariableGuid, &hash_job.hash,
+				 L"(dtbloader) DTB has changed! Press any key to confirm...");
 }
 
 static EFI_STATUS install_dtb_config_table(EFI_HANDLE ImageHandle, struct device *dev)
 {
 	EFI_GUID EfiDtbTableGuid = EFI_DTB_TABLE_GUID;
+	struct dtb_load ld;
 	EFI_STATUS status;
 	UINT8 *dtb = NULL;
+	int stage, prefetch;
 
-	status = load_dtb(ImageHandle, dev, &dtb);
+	stage = timing_begin(L"load");
+	status = load_dtb_start(ImageHandle, dev, &ld);
+	if (EFI_ERROR(status)) {
+		timing_end(stage);
+		return status;
+	}
+
+	/*
+	 * While the file is being read, start the slow I/O needed by the
+	 * fixups. Errors are kept by the device and reported by the fixup.
+	 */
+	if (dev->prefetch) {
+		prefetch = timing_begin(L"prefetch");
+		dev->prefetch(dev);
+		timing_end(prefetch);
+	}
+
+	status = load_dtb_finish(&ld, &dtb);
+	timing_end(stage);
 	if (EFI_ERROR(status))
 		return status;
 
@@ -205,30 +393,40 @@ static EFI_STATUS install_dtb_config_table(EFI_HANDLE ImageHandle, struct device
 	 * NOTE: load_dtb resizes the dtb to the buffer size so maybe
 	 * it's not the best place to check the hash...
 	 */
+	stage = timing_begin(L"hash");
 	status = check_dtb_hash(dtb);
+	timing_end(stage);
 	if (EFI_ERROR(status))
 		return status;
 
+	stage = timing_begin(L"fixup");
 	status = apply_dt_fixups(dev, dtb);
+	timing_end(stage);
 	if (EFI_ERROR(status)) {
 		Print(L"Failed to fixup dtb: %r\n", status);
 		return status;
 	}
 
-	status = finalize_dtb(dtb);
+	stage = timing_begin(L"pack");
+	status = finalize_dtb(dev, dtb);
+	timing_end(stage);
 	if (EFI_ERROR(status))
 		return status;
 
+	stage = timing_begin(L"install");
 	status = uefi_call_wrapper(BS->InstallConfigurationTable, 2, &EfiDtbTableGuid, dtb);
+	timing_end(stage);
 	if (EFI_ERROR(status)) {
 		Print(L"Failed to install dtb config table: %r\n", status);
 		return status;
 	}
 
+	instance_set_dtb((EFI_PHYSICAL_ADDRESS)dtb, DTB_PAGES);
+
 	return EFI_SUCCESS;
 }
 
-static EFI_STATUS efi_dt_fixup(EFI_DT_FIXUP_PROTOCOL *this, void *dtb, UINTN *size, UINT32 flags)
+static EFI_STATUS __efi_dt_fixup(void *dtb, UINTN *size, UINT32 flags)
 {
 	struct device *dev = match_device();
 	UINTN extra_space = 4096 * 4;
@@ -263,7 +461,20 @@ static EFI_STATUS efi_dt_fixup(EFI_DT_FIXUP_PROTOCOL *this, void *dtb, UINTN *si
 		}
 	}
 
-	return finalize_dtb(dtb);
+	return finalize_dtb(dev, dtb);
+}
+
+static EFI_STATUS EFIAPI efi_dt_fixup(EFI_DT_FIXUP_PROTOCOL *this, void *dtb, UINTN *size, UINT32 flags)
+{
+	int stage = timing_begin(L"dt-fixup");
+	EFI_STATUS status;
+
+	status = __efi_dt_fixup(dtb, size, flags);
+	timing_end(stage);
+
+	arena_release();
+
+	return status;
 }
 
 static EFI_DT_FIXUP_PROTOCOL fixup_prot = {
@@ -271,13 +482,13 @@ static EFI_DT_FIXUP_PROTOCOL fixup_prot = {
 	.Fixup = efi_dt_fixup,
 };
 
-static EFI_STATUS install_dt_fixup_protocol(void)
+static EFI_STATUS install_dt_fixup_protocol(EFI_HANDLE *fixup_handle)
 {
 	EFI_STATUS status;
 	EFI_GUID efi_dt_fixup_prot_guid = EFI_DT_FIXUP_PROTOCOL_GUID;
-	EFI_HANDLE fixup_handle = NULL;
 
-	status = uefi_call_wrapper(BS->InstallProtocolInterface, 4, &fixup_handle, &efi_dt_fixup_prot_guid,
+	*fixup_handle = NULL;
+	status = uefi_call_wrapper(BS->InstallProtocolInterface, 4, fixup_handle, &efi_dt_fixup_prot_guid,
 			EFI_NATIVE_INTERFACE, &fixup_prot);
 	if (EFI_ERROR(status)) {
 		Print(L"Failed to install fixup protocol: %r\n", status);
@@ -287,15 +498,195 @@ static EFI_STATUS install_dt_fixup_protocol(void)
 	return EFI_SUCCESS;
 }
 
-EFI_STATUS efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
+/*
+ * Self-benchmark, see bench.c
+ */
+
+struct bench_ctx {
+	EFI_HANDLE image;
+	struct device *dev;
+	UINT8 *dtb;
+	UINT8 *work;
+};
+
+static EFI_STATUS bench_match(void *ctx)
+{
+	return detect_device() ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
+
+static EFI_STATUS bench_chid(void *ctx)
+{
+	EFI_GUID hwids[15];
+
+	return populate_board_hwids(hwids);
+}
+
+static EFI_STATUS bench_load(void *ctx)
+{
+	struct bench_ctx *b = ctx;
+	EFI_STATUS status;
+	UINT8 *dtb;
+
+	status = load_dtb(b->image, b->dev, &dtb);
+	if (EFI_ERROR(status))
+		return status;
+
+	FreePages((EFI_PHYSICAL_ADDRESS)dtb, DTB_PAGES);
+	return EFI_SUCCESS;
+}
+
+/* Same work as check_dtb_hash() but never prompts or writes the variable. */
+static EFI_STATUS bench_hash(void *ctx)
+{
+	struct bench_ctx *b = ctx;
+	EFI_SHA1_HASH *old_hash, new_hash;
+
+	old_hash = arena_get_variable(L"DtbloaderDtbHash", &gEfiGlobalVariableGuid, NULL);
+	SHA1((void*)&new_hash, (void*)b->dtb, fdt_totalsize(b->dtb));
+
+	(void)old_hash;
+
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS bench_copy_dtb(void *ctx)
+{
+	struct bench_ctx *b = ctx;
+
+	CopyMem(b->work, b->dtb, fdt_totalsize(b->dtb));
+
+	return fdt_open_into(b->work, b->work, DTB_MAX_SIZE) ? EFI_LOAD_ERROR : EFI_SUCCESS;
+}
+
+static EFI_STATUS bench_fixup(void *ctx)
+{
+	struct bench_ctx *b = ctx;
+
+	return apply_dt_fixups(b->dev, b->work);
+}
+
+static EFI_STATUS bench_copy_fixed_dtb(void *ctx)
+{
+	EFI_STATUS status;
+
+	status = bench_copy_dtb(ctx);
+	if (EFI_ERROR(status))
+		return status;
+
+	return bench_fixup(ctx);
+}
+
+static EFI_STATUS bench_pack(void *ctx)
 {
+	struct bench_ctx *b = ctx;
+
+	return finalize_dtb(b->dev, b->work);
+}
+
+static EFI_STATUS run_benchmarks(EFI_HANDLE ImageHandle, struct device *dev, UINTN iterations)
+{
+	static const struct bench_stage stages[] = {
+		{ .name = L"match", .run = bench_match },
+		{ .name = L"chid",  .run = bench_chid },
+	};
+	static const struct bench_stage dtb_stages[] = {
+		{ .name = L"load",  .run = bench_load },
+		{ .name = L"hash",  .run = bench_hash },
+		{ .name = L"fixup", .setup = bench_copy_dtb, .run = bench_fixup },
+		{ .name = L"pack",  .setup = bench_copy_fixed_dtb, .run = bench_pack },
+	};
+	struct bench_ctx ctx = { .image = ImageHandle, .dev = dev };
+	EFI_PHYSICAL_ADDRESS work;
+	EFI_STATUS status;
+	int i;
+
+	Print(L"Running benchmarks, %d iterations, %ld ticks per second\n", iterations, timer_freq());
+
+	for (i = 0; i < ARRAY_SIZE(stages); ++i) {
+		status = bench_run(&stages[i], &ctx, iterations);
+		if (EFI_ERROR(status))
+			return status;
+	}
+
+	status = load_dtb(ImageHandle, dev, &ctx.dtb);
+	if (EFI_ERROR(status)) {
+		Print(L"bench: No dtb, skipping dtb stages: %r\n", status);
+	} else {
+		status = AllocateZeroPages(DTB_PAGES, &work);
+		if (EFI_ERROR(status))
+			goto out;
+
+		ctx.work = (UINT8 *)work;
+
+		for (i = 0; i < ARRAY_SIZE(dtb_stages); ++i) {
+			status = bench_run(&dtb_stages[i], &ctx, iterations);
+			if (EFI_ERROR(status))
+				break;
+		}
+
+		FreePages(work, DTB_PAGES);
+		if (EFI_ERROR(status))
+			goto out;
+	}
+
+	status = bench_memmove(iterations);
+
+out:
+	if (ctx.dtb)
+		FreePages((EFI_PHYSICAL_ADDRESS)ctx.dtb, DTB_PAGES);
+
+	return status;
+}
+
+static EFI_STATUS dtbloader_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
+{
+	EFI_HANDLE fixup_handle;
 	EFI_STATUS status;
 	struct device *dev;
+	UINTN iterations;
+	int stage;
 
 	InitializeLib(ImageHandle, SystemTable);
 	Dbg(L"dtbloader!\n");
 
+#ifdef EFI_DEBUG
+	/* Used by scripts/profile_qemu.sh to find where we were relocated to. */
+	EFI_LOADED_IMAGE *image;
+	if (!EFI_ERROR(uefi_call_wrapper(BS->HandleProtocol, 3, ImageHandle, &LoadedImageProtocol, (void **)&image)))
+		Dbg(L"Image base: 0x%lx\n", image->ImageBase);
+#endif
+
+	/* Benchmarks only measure, nothing gets installed. */
+	iterations = bench_iterations(ImageHandle);
+
+	/*
+	 * We may be loaded twice, i.e. from Driver#### and by the bootloader.
+	 * Leave everything to the first copy unless we are a newer build.
+	 * Like below, EFI_ABORTED makes us unload without a warning.
+	 */
+	if (!iterations && instance_find() == EFI_ALREADY_STARTED)
+		return EFI_ABORTED;
+
+	/* The CHIDs are hashed on another CPU while we read the database. */
+	match_device_start();
+
+	stage = timing_begin(L"devdb");
+	status = devdb_load(ImageHandle);
+	timing_end(stage);
+	if (EFI_ERROR(status) && status != EFI_NOT_FOUND)
+		Print(L"Ignoring the device database: %r\n", status);
+
+	stage = timing_begin(L"match");
 	dev = match_device();
+	timing_end(stage);
+
+	/* Others may reuse our CHIDs even if we don't support this device. */
+	if (!iterations) {
+		status = publish_match(dev);
+		if (EFI_ERROR(status))
+			Dbg(L"Failed to publish match result: %r\n", status);
+	}
+
 	if (!dev) {
 		Print(L"Failed to detect this device!\n");
 		/*
@@ -316,6 +707,9 @@ EFI_STATUS efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
 
 	Print(L"Detected device: %s\n", dev->name);
 
+	if (iterations)
+		return run_benchmarks(ImageHandle, dev, iterations);
+
 	/*
 	 * It's normal for us to ignore missing dtb file, since only
 	 * providing the fixup protocol is a valid usecase.
@@ -326,11 +720,34 @@ EFI_STATUS efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
 		return status;
 	}
 
-	status = install_dt_fixup_protocol();
+	status = install_dt_fixup_protocol(&fixup_handle);
 	if (EFI_ERROR(status)) {
 		Print(L"Failed to install dt fixup protocol: %r\n", status);
 		return status;
 	}
 
+	status = instance_publish(dev, fixup_handle, &fixup_prot);
+	if (EFI_ERROR(status))
+		Dbg(L"Failed to publish dtbloader protocol: %r\n", status);
+
+	/* Let others have the provisioning data we read anyway. */
+	status = qcom_dpp_publish(dev);
+	if (EFI_ERROR(status) && status != EFI_UNSUPPORTED)
+		Dbg(L"Failed to install DPP protocol: %r\n", status);
+
+	timing_report();
+
 	return EFI_SUCCESS;
 }
+
+EFI_STATUS efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
+{
+	EFI_STATUS status;
+
+	status = dtbloader_main(ImageHandle, SystemTable);
+
+	/* Whatever happened, transient allocations are not needed anymore. */
+	arena_release();
+
+	return status;
+}
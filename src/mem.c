@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Bulk memory moves.
+ *
+ * gnu-efi only provides byte-by-byte CopyMem/SetMem and libfdt shuffles
+ * the whole dtb around in fdt_open_into()/fdt_pack(), so provide proper
+ * memcpy/memset/memmove for both us and libfdt. The gnu-efi versions are
+ * renamed away in the Makefile so these are picked at link time.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <arm_neon.h>
+
+#include <string.h>
+
+#define CHUNK	16
+#define BLOCK	(4 * CHUNK)
+
+/*
+ * Every block is fully loaded before it is stored (LDP/STP of q regs),
+ * which keeps forward copies correct for overlapping buffers as long as
+ * dest is below src.
+ */
+static void copy_forward(uint8_t *d, const uint8_t *s, size_t n)
+{
+	/* Align the destination so the stores don't straddle cache lines. */
+	while (n && ((uintptr_t)d & (CHUNK - 1))) {
+		*d++ = *s++;
+		n--;
+	}
+
+	while (n >= BLOCK) {
+		uint8x16_t a = vld1q_u8(s);
+		uint8x16_t b = vld1q_u8(s + CHUNK);
+		uint8x16_t c = vld1q_u8(s + 2 * CHUNK);
+		uint8x16_t e = vld1q_u8(s + 3 * CHUNK);
+
+		vst1q_u8(d, a);
+		vst1q_u8(d + CHUNK, b);
+		vst1q_u8(d + 2 * CHUNK, c);
+		vst1q_u8(d + 3 * CHUNK, e);
+
+		d += BLOCK;
+		s += BLOCK;
+		n -= BLOCK;
+	}
+
+	while (n >= CHUNK) {
+		vst1q_u8(d, vld1q_u8(s));
+		d += CHUNK;
+		s += CHUNK;
+		n -= CHUNK;
+	}
+
+	while (n--)
+		*d++ = *s++;
+}
+
+/* Same as above, mirrored for dest above src. */
+static void copy_backward(uint8_t *d, const uint8_t *s, size_t n)
+{
+	d += n;
+	s += n;
+
+	while (n && ((uintptr_t)d & (CHUNK - 1))) {
+		*--d = *--s;
+		n--;
+	}
+
+	while (n >= BLOCK) {
+		uint8x16_t a = vld1q_u8(s - CHUNK);
+		uint8x16_t b = vld1q_u8(s - 2 * CHUNK);
+		uint8x16_t c = vld1q_u8(s - 3 * CHUNK);
+		uint8x16_t e = vld1q_u8(s - 4 * CHUNK);
+
+		vst1q_u8(d - CHUNK, a);
+		vst1q_u8(d - 2 * CHUNK, b);
+		vst1q_u8(d - 3 * CHUNK, c);
+		vst1q_u8(d - 4 * CHUNK, e);
+
+		d -= BLOCK;
+		s -= BLOCK;
+		n -= BLOCK;
+	}
+
+	while (n >= CHUNK) {
+		d -= CHUNK;
+		s -= CHUNK;
+		n -= CHUNK;
+		vst1q_u8(d, vld1q_u8(s));
+	}
+
+	while (n--)
+		*--d = *--s;
+}
+
+static void fill(uint8_t *d, uint8_t c, size_t n)
+{
+	uint8x16_t v = vdupq_n_u8(c);
+
+	while (n && ((uintptr_t)d & (CHUNK - 1))) {
+		*d++ = c;
+		n--;
+	}
+
+	while (n >= BLOCK) {
+		vst1q_u8(d, v);
+		vst1q_u8(d + CHUNK, v);
+		vst1q_u8(d + 2 * CHUNK, v);
+		vst1q_u8(d + 3 * CHUNK, v);
+		d += BLOCK;
+		n -= BLOCK;
+	}
+
+	while (n >= CHUNK) {
+		vst1q_u8(d, v);
+		d += CHUNK;
+		n -= CHUNK;
+	}
+
+	while (n--)
+		*d++ = c;
+}
+
+/**
+ * zva_block_size() - Get the DC ZVA block size or 0 if it can't be used.
+ */
+static size_t zva_block_size(void)
+{
+	static size_t zva_size = -1;
+	uint64_t dczid;
+
+	if (zva_size != (size_t)-1)
+		return zva_size;
+
+	asm volatile("mrs %0, dczid_el0" : "=r" (dczid));
+
+	/* DZP bit means DC ZVA is prohibited, BS is log2 of the size in words. */
+	if (dczid & (1 << 4))
+		zva_size = 0;
+	else
+		zva_size = 4 << (dczid & 0xf);
+
+	return zva_size;
+}
+
+/**
+ * zero_zva() - Zero all whole DC ZVA blocks inside the range.
+ * @d:    Start of the range.
+ * @n:    Size of the range.
+ * @head: Set to the amount of bytes before the first zeroed block.
+ *
+ * Returns: Amount of bytes zeroed, 0 if the range is too small.
+ */
+static size_t zero_zva(uint8_t *d, size_t n, size_t *head)
+{
+	size_t zva = zva_block_size();
+	uintptr_t start, end, p;
+
+	/* Not worth it for less than a few blocks. */
+	if (!zva || n < 4 * zva)
+		return 0;
+
+	start = ((uintptr_t)d + zva - 1) & ~(uintptr_t)(zva - 1);
+	end   = ((uintptr_t)d + n) & ~(uintptr_t)(zva - 1);
+
+	for (p = start; p < end; p += zva)
+		asm volatile("dc zva, %0" : : "r" (p) : "memory");
+
+	*head = start - (uintptr_t)d;
+	return end - start;
+}
+
+void *memcpy(void *dest, const void *src, size_t count)
+{
+	copy_forward(dest, src, count);
+	return dest;
+}
+
+void *memmove(void *dest, const void *src, size_t count)
+{
+	uint8_t *d = dest;
+	const uint8_t *s = src;
+
+	if (d == s || !count)
+		return dest;
+
+	if (d < s || d >= s + count)
+		copy_forward(d, s, count);
+	else
+		copy_backward(d, s, count);
+
+	return dest;
+}
+
+void *memset(void *s, int c, size_t count)
+{
+	uint8_t *d = s;
+	size_t head, zeroed;
+
+	if (!c) {
+		zeroed = zero_zva(d, count, &head);
+		if (zeroed) {
+			fill(d, 0, head);
+			fill(d + head + zeroed, 0, count - head - zeroed);
+			return s;
+		}
+	}
+
+	fill(d, c, count);
+	return s;
+}
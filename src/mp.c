@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Offload of CPU-bound work to application processors.
+ *
+ * Jobs are started on an idle AP using EFI_MP_SERVICES_PROTOCOL in
+ * non-blocking mode, so the BSP can keep doing firmware calls (file reads,
+ * variables...) in the meantime. Firmware services are not MP-safe, so
+ * jobs may only touch memory that is already allocated.
+ *
+ * Without the protocol, or with every AP busy, the job is deferred and
+ * runs on the BSP when waited for, which is the same as the serial code.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <util.h>
+#include <mp.h>
+
+#include <protocol/mp_services.h>
+
+#define MP_MAX_CPUS	64
+
+static EFI_MP_SERVICES_PROTOCOL *mp;
+static UINT64 ap_mask;
+static UINT64 ap_busy;
+static bool mp_probed;
+
+static void mp_probe(void)
+{
+	EFI_GUID mp_guid = EFI_MP_SERVICES_PROTOCOL_GUID;
+	EFI_PROCESSOR_INFORMATION info;
+	UINTN count, enabled, i;
+	EFI_STATUS status;
+
+	mp_probed = true;
+
+	status = uefi_call_wrapper(BS->LocateProtocol, 3, &mp_guid, NULL, (void **)&mp);
+	if (EFI_ERROR(status)) {
+		mp = NULL;
+		return;
+	}
+
+	status = uefi_call_wrapper(mp->GetNumberOfProcessors, 3, mp, &count, &enabled);
+	if (EFI_ERROR(status))
+		return;
+
+	for (i = 0; i < count && i < MP_MAX_CPUS; ++i) {
+		status = uefi_call_wrapper(mp->GetProcessorInfo, 3, mp, i, &info);
+		if (EFI_ERROR(status))
+			continue;
+
+		if (info.StatusFlag & PROCESSOR_AS_BSP_BIT)
+			continue;
+
+		if ((info.StatusFlag & (PROCESSOR_ENABLED_BIT | PROCESSOR_HEALTH_STATUS_BIT)) !=
+		    (PROCESSOR_ENABLED_BIT | PROCESSOR_HEALTH_STATUS_BIT))
+			continue;
+
+		ap_mask |= 1ULL << i;
+	}
+
+	Dbg(L"MP: %d CPUs, %d enabled, AP mask 0x%lx\n", count, enabled, ap_mask);
+}
+
+static void EFIAPI mp_job_trampoline(void *arg)
+{
+	struct mp_job *job = arg;
+
+	job->fn(job->arg);
+}
+
+/**
+ * mp_job_start() - Start a job on an idle AP if there is one.
+ * @job:  Job to fill in.
+ * @fn:   Function to run, it must not call into the firmware.
+ * @arg:  Argument for @fn.
+ *
+ * If no AP can take the job, it's deferred until mp_job_wait().
+ */
+void mp_job_start(struct mp_job *job, void (*fn)(void *arg), void *arg)
+{
+	EFI_STATUS status;
+	UINTN cpu;
+
+	job->fn = fn;
+	job->arg = arg;
+	job->state = MP_JOB_DEFERRED;
+
+	if (!mp_probed)
+		mp_probe();
+
+	/* The completion event can't be waited for above TPL_APPLICATION. */
+	if (!mp || !(ap_mask & ~ap_busy) || !CanWait())
+		return;
+
+	for (cpu = 0; !((ap_mask & ~ap_busy) & (1ULL << cpu)); ++cpu)
+		;
+
+	status = uefi_call_wrapper(BS->CreateEvent, 5, 0, TPL_CALLBACK, NULL, NULL, &job->event);
+	if (EFI_ERROR(status))
+		return;
+
+	status = uefi_call_wrapper(mp->StartupThisAP, 7, mp, mp_job_trampoline, cpu,
+				   job->event, 0, job, NULL);
+	if (EFI_ERROR(status)) {
+		Dbg(L"MP: Failed to start a job on CPU %d: %r\n", cpu, status);
+		uefi_call_wrapper(BS->CloseEvent, 1, job->event);
+		return;
+	}
+
+	ap_busy |= 1ULL << cpu;
+	job->cpu = cpu;
+	job->state = MP_JOB_RUNNING;
+}
+
+/**
+ * mp_job_wait() - Wait for the job to complete, running it here if it was deferred.
+ */
+void mp_job_wait(struct mp_job *job)
+{
+	switch (job->state) {
+	case MP_JOB_DEFERRED:
+		job->fn(job->arg);
+		break;
+	case MP_JOB_RUNNING:
+		WaitEvent(job->event);
+		uefi_call_wrapper(BS->CloseEvent, 1, job->event);
+		ap_busy &= ~(1ULL << job->cpu);
+		break;
+	}
+
+	job->state = MP_JOB_IDLE;
+}
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Minimal profile runtime for "make PGO_GEN=1" builds.
+ *
+ * clang puts the profile data, counters and names of every instrumented
+ * function into .lprf* sections, same as with compiler-rt on Windows. This
+ * wraps efi_main() and, once it returns, dumps those sections in the raw
+ * profile format into \dtbloader.profraw on the volume we were loaded from.
+ * The result can be fed to "llvm-profdata merge", see scripts/pgo_train.sh.
+ *
+ * Only raw format versions 9 and 10 are supported, value profiling has to
+ * be disabled (-mllvm -disable-vp=true) since there is no runtime for it.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <util.h>
+
+#define PGO_FILE_NAME		L"\\dtbloader.profraw"
+
+#define INSTR_PROF_RAW_MAGIC_64	((UINT64)255 << 56 | (UINT64)'l' << 48 | (UINT64)'p' << 40 | \
+				 (UINT64)'r' << 32 | (UINT64)'o' << 24 | (UINT64)'f' << 16 | \
+				 (UINT64)'r' << 8 | (UINT64)129)
+
+#pragma section(".lprfd$A", read, write)
+#pragma section(".lprfd$Z", read, write)
+#pragma section(".lprfc$A", read, write)
+#pragma section(".lprfc$Z", read, write)
+#pragma section(".lprfb$A", read, write)
+#pragma section(".lprfb$Z", read, write)
+#pragma section(".lprfn$A", read)
+#pragma section(".lprfn$Z", read)
+
+__declspec(allocate(".lprfd$A")) __attribute__((used)) char pgo_data_start;
+__declspec(allocate(".lprfd$Z")) __attribute__((used)) char pgo_data_end;
+__declspec(allocate(".lprfc$A")) __attribute__((used)) char pgo_counters_start;
+__declspec(allocate(".lprfc$Z")) __attribute__((used)) char pgo_counters_end;
+__declspec(allocate(".lprfb$A")) __attribute__((used)) char pgo_bitmap_start;
+__declspec(allocate(".lprfb$Z")) __attribute__((used)) char pgo_bitmap_end;
+__declspec(allocate(".lprfn$A")) __attribute__((used)) const char pgo_names_start;
+__declspec(allocate(".lprfn$Z")) __attribute__((used)) const char pgo_names_end;
+
+/* Referenced by every instrumented object to pull the runtime in. */
+int __llvm_profile_runtime;
+
+/* Emitted by the compiler: format version and variant flags. */
+extern UINT64 __llvm_profile_raw_version;
+
+/* Size of struct __llvm_profile_data for versions 9 and 10. */
+#define PROF_DATA_SIZE		64
+
+EFI_STATUS efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable);
+
+static UINTN align_up(UINTN val, UINTN align)
+{
+	return (val + align - 1) & ~(align - 1);
+}
+
+static EFI_STATUS write_chunk(EFI_FILE_HANDLE file, const void *buf, UINTN size)
+{
+	static const UINT8 zeroes[8];
+	EFI_STATUS status;
+	UINTN len = size;
+
+	if (!buf)
+		buf = zeroes;
+
+	status = uefi_call_wrapper(file->Write, 3, file, &len, (void *)buf);
+	if (EFI_ERROR(status))
+		return status;
+
+	return len == size ? EFI_SUCCESS : EFI_DEVICE_ERROR;
+}
+
+/**
+ * pgo_write_profile() - Dump the profile counters to the ESP.
+ */
+static EFI_STATUS pgo_write_profile(EFI_HANDLE ImageHandle)
+{
+	UINT8 *data = (UINT8 *)align_up((UINTN)(&pgo_data_start + 1), 8);
+	UINT8 *counters = (UINT8 *)align_up((UINTN)(&pgo_counters_start + 1), 8);
+	UINT8 *bitmap = (UINT8 *)(&pgo_bitmap_start + 1);
+	const char *names = &pgo_names_start + 1;
+	UINTN data_size = (UINT8 *)&pgo_data_end - data;
+	UINTN counters_size = (UINT8 *)&pgo_counters_end - counters;
+	UINTN bitmap_size = (UINT8 *)&pgo_bitmap_end - bitmap;
+	UINTN names_size = &pgo_names_end - names;
+	UINT32 version = __llvm_profile_raw_version & 0xffffffff;
+	EFI_FILE_HANDLE volume, file;
+	UINT64 header[16];
+	EFI_STATUS status;
+	int n = 0;
+
+	if (version != 9 && version != 10) {
+		Print(L"pgo: Unsupported raw profile version %d\n", version);
+		return EFI_UNSUPPORTED;
+	}
+
+	header[n++] = INSTR_PROF_RAW_MAGIC_64;
+	header[n++] = __llvm_profile_raw_version;
+	header[n++] = 0;				/* BinaryIdsSize */
+	header[n++] = data_size / PROF_DATA_SIZE;	/* NumData */
+	header[n++] = 0;				/* PaddingBytesBeforeCounters */
+	header[n++] = counters_size / sizeof(UINT64);	/* NumCounters */
+	header[n++] = align_up(counters_size, 8) - counters_size;
+	header[n++] = bitmap_size;			/* NumBitmapBytes */
+	header[n++] = align_up(bitmap_size, 8) - bitmap_size;
+	header[n++] = names_size;			/* NamesSize */
+	header[n++] = (UINTN)counters - (UINTN)data;	/* CountersDelta */
+	header[n++] = (UINTN)bitmap - (UINTN)data;	/* BitmapDelta */
+	header[n++] = (UINTN)names;			/* NamesDelta */
+	if (version >= 10) {
+		header[n++] = 0;			/* NumVTables */
+		header[n++] = 0;			/* VNamesSize */
+	}
+	header[n++] = version >= 10 ? 2 : 1;		/* ValueKindLast */
+
+	volume = GetVolume(ImageHandle);
+	if (!volume)
+		return EFI_NOT_FOUND;
+
+	/* Drop the profile of the previous run, if any. */
+	status = uefi_call_wrapper(volume->Open, 5, volume, &file, PGO_FILE_NAME,
+				   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+	if (!EFI_ERROR(status))
+		uefi_call_wrapper(file->Delete, 1, file);
+
+	status = uefi_call_wrapper(volume->Open, 5, volume, &file, PGO_FILE_NAME,
+				   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0);
+	if (EFI_ERROR(status))
+		return status;
+
+	status = write_chunk(file, header, n * sizeof(header[0]));
+	if (!EFI_ERROR(status))
+		status = write_chunk(file, data, data_size);
+	if (!EFI_ERROR(status))
+		status = write_chunk(file, counters, counters_size);
+	if (!EFI_ERROR(status))
+		status = write_chunk(file, NULL, align_up(counters_size, 8) - counters_size);
+	if (!EFI_ERROR(status))
+		status = write_chunk(file, bitmap, bitmap_size);
+	if (!EFI_ERROR(status))
+		status = write_chunk(file, NULL, align_up(bitmap_size, 8) - bitmap_size);
+	if (!EFI_ERROR(status))
+		status = write_chunk(file, names, names_size);
+	if (!EFI_ERROR(status))
+		status = write_chunk(file, NULL, align_up(names_size, 8) - names_size);
+
+	FileClose(file);
+
+	return status;
+}
+
+/**
+ * pgo_efi_main() - Entry point of instrumented builds.
+ */
+EFI_STATUS pgo_efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
+{
+	EFI_STATUS status, pgo_status;
+
+	status = efi_main(ImageHandle, SystemTable);
+
+	pgo_status = pgo_write_profile(ImageHandle);
+	if (EFI_ERROR(pgo_status))
+		Print(L"pgo: Failed to write the profile: %r\n", pgo_status);
+
+	return status;
+}
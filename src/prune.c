@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Shrinking the DTB before it's handed over.
+ *
+ * The kernel unflattens every node in the DTB, including the many disabled
+ * ones and the overlay metadata that is useless once nothing is going to
+ * apply overlays on top. Devices opt in with struct device .dt_prune.
+ *
+ * Any aligned cell of any property that looks like a phandle counts as a
+ * reference. That keeps a few nodes that could go, but never removes one
+ * that is used, without knowing which properties hold phandles.
+ */
+
+#include <stdbool.h>
+#include <efi.h>
+#include <efilib.h>
+#include <libfdt.h>
+
+#include <util.h>
+#include <arena.h>
+#include <prune.h>
+
+static const char * const overlay_nodes[] = {
+	"/__symbols__",
+	"/__fixups__",
+	"/__local_fixups__",
+};
+
+static bool is_phandle_prop(const char *name)
+{
+	return !strcmpa((CHAR8 *)name, (CHAR8 *)"phandle") ||
+	       !strcmpa((CHAR8 *)name, (CHAR8 *)"linux,phandle");
+}
+
+/**
+ * mark_references() - Set a bit in @refs for every phandle-like cell.
+ * @max:  Largest phandle in the tree.
+ */
+static void mark_references(void *dtb, UINT8 *refs, UINT32 max)
+{
+	const fdt32_t *cells;
+	const char *name;
+	int node, prop, len, i;
+	UINT32 val;
+
+	for (node = fdt_next_node(dtb, -1, NULL); node >= 0; node = fdt_next_node(dtb, node, NULL)) {
+		fdt_for_each_property_offset(prop, dtb, node) {
+			cells = fdt_getprop_by_offset(dtb, prop, &name, &len);
+			if (!cells || len % sizeof(*cells) || is_phandle_prop(name))
+				continue;
+
+			for (i = 0; i < len / (int)sizeof(*cells); ++i) {
+				val = fdt32_to_cpu(cells[i]);
+				if (val && val <= max)
+					refs[val / 8] |= 1 << (val % 8);
+			}
+		}
+	}
+}
+
+static bool is_disabled(void *dtb, int node)
+{
+	const char *status;
+	int len;
+
+	status = fdt_getprop(dtb, node, "status", &len);
+
+	return status && len >= 8 && !memcmp(status, "disabled", 8);
+}
+
+/**
+ * subtree_unreferenced() - Check that no phandle in the subtree is used.
+ */
+static bool subtree_unreferenced(void *dtb, int node, UINT8 *refs)
+{
+	UINT32 phandle;
+	int depth = 0;
+
+	do {
+		phandle = fdt_get_phandle(dtb, node);
+		if (phandle && refs[phandle / 8] & (1 << (phandle % 8)))
+			return false;
+
+		node = fdt_next_node(dtb, node, &depth);
+	} while (node >= 0 && depth > 0);
+
+	return true;
+}
+
+static EFI_STATUS prune_disabled(void *dtb, UINTN *removed)
+{
+	int node, depth = 0, victim_depth, count = 0, i;
+	int *victims;
+	UINT8 *refs;
+	UINT32 max;
+
+	if (fdt_find_max_phandle(dtb, &max))
+		return EFI_INVALID_PARAMETER;
+
+	/* Every node takes at least 12 bytes of the struct block. */
+	refs = arena_alloc(max / 8 + 1);
+	victims = arena_alloc(fdt_size_dt_struct(dtb) / 12 * sizeof(*victims));
+	if (!refs || !victims)
+		return EFI_OUT_OF_RESOURCES;
+
+	mark_references(dtb, refs, max);
+
+	/* The root node is at depth 1. */
+	node = fdt_next_node(dtb, -1, &depth);
+	while (node >= 0) {
+		if (depth > 1 && is_disabled(dtb, node) && subtree_unreferenced(dtb, node, refs)) {
+			victims[count++] = node;
+
+			/* Skip the children, they go away together with it. */
+			victim_depth = depth;
+			do {
+				node = fdt_next_node(dtb, node, &depth);
+			} while (node >= 0 && depth > victim_depth);
+
+			continue;
+		}
+
+		node = fdt_next_node(dtb, node, &depth);
+	}
+
+	/* Back to front, so removing one doesn't move the ones left. */
+	for (i = count - 1; i >= 0; --i)
+		if (fdt_del_node(dtb, victims[i]))
+			return EFI_INVALID_PARAMETER;
+
+	*removed += count;
+	return EFI_SUCCESS;
+}
+
+/**
+ * dt_prune() - Remove nodes the OS won't need.
+ * @dtb:    FDT to prune, packed afterwards by the caller.
+ * @flags:  DT_PRUNE_* flags of the device.
+ */
+EFI_STATUS dt_prune(void *dtb, UINT32 flags)
+{
+	int size = fdt_size_dt_struct(dtb);
+	EFI_STATUS status;
+	UINTN removed = 0;
+	int node, i;
+
+	/* __symbols__ would keep pointing at the removed nodes. */
+	if (flags & DT_PRUNE_DISABLED)
+		flags |= DT_PRUNE_OVERLAY;
+
+	if (flags & DT_PRUNE_OVERLAY) {
+		for (i = 0; i < ARRAY_SIZE(overlay_nodes); ++i) {
+			node = fdt_path_offset(dtb, overlay_nodes[i]);
+			if (node < 0)
+				continue;
+
+			if (fdt_del_node(dtb, node))
+				return EFI_INVALID_PARAMETER;
+			removed++;
+		}
+	}
+
+	if (flags & DT_PRUNE_DISABLED) {
+		status = prune_disabled(dtb, &removed);
+		if (EFI_ERROR(status))
+			return status;
+	}
+
+	Dbg(L"Pruned %d subtrees, %d bytes\n", removed, size - fdt_size_dt_struct(dtb));
+
+	return EFI_SUCCESS;
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Publish the detection result.
+ *
+ * systemd-boot, fwupd and installers compute the same CHIDs from SMBIOS
+ * that we already have. Hand them over together with what we matched,
+ * see protocol/dtbloader_match.h for the format.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <util.h>
+#include <device.h>
+#include <instance.h>
+#include <publish.h>
+
+#include <protocol/dtbloader_match.h>
+
+static void copy_name(CHAR16 *dst, UINTN len, const CHAR16 *src)
+{
+	UINTN i;
+
+	if (!src)
+		return;
+
+	for (i = 0; i < len - 1 && src[i]; ++i)
+		dst[i] = src[i];
+}
+
+/**
+ * publish_match() - Install the match table and variable.
+ * @dev:  Matched device or NULL, the CHIDs are published either way.
+ */
+EFI_STATUS publish_match(struct device *dev)
+{
+	EFI_GUID match_guid = DTBLOADER_MATCH_TABLE_GUID;
+	DTBLOADER_MATCH_TABLE *table;
+	struct match_result *res = match_result();
+	EFI_GUID *hwids = match_hwids();
+	EFI_STATUS status;
+
+	if (!res || !hwids)
+		return EFI_NOT_READY;
+
+	/* Stays around for the bootloader, so not from the arena. */
+	table = AllocateZeroPool(sizeof(*table));
+	if (!table)
+		return EFI_OUT_OF_RESOURCES;
+
+	table->Revision = DTBLOADER_MATCH_TABLE_REVISION;
+	table->Size = sizeof(*table);
+	table->Version = DTBLOADER_VERSION;
+	table->MatchedChid = DTBLOADER_MATCH_NONE;
+	table->MatchedLevel = DTBLOADER_MATCH_NONE;
+	CopyMem(table->Chids, hwids, sizeof(table->Chids));
+
+	if (dev) {
+		table->Flags |= DTBLOADER_MATCH_FOUND;
+		if (res->devdb)
+			table->Flags |= DTBLOADER_MATCH_DEVDB;
+
+		table->MatchedChid = res->chid;
+		table->MatchedLevel = res->level;
+
+		copy_name(table->DeviceName, ARRAY_SIZE(table->DeviceName), dev->name);
+		copy_name(table->DtbName, ARRAY_SIZE(table->DtbName), dev->dtb);
+	}
+
+	status = uefi_call_wrapper(BS->InstallConfigurationTable, 2, &match_guid, table);
+	if (EFI_ERROR(status)) {
+		FreePool(table);
+		return status;
+	}
+
+	return uefi_call_wrapper(RT->SetVariable, 5, DTBLOADER_MATCH_VARIABLE, &match_guid,
+				 EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+				 sizeof(*table), table);
+}
@@ -8,35 +8,10 @@
 #include <util.h>
 #include <device.h>
 #include <chid.h>
+#include <arena.h>
 
-#define EFI_PARTITION_INFO_PROTOCOL_GUID \
-  { 0x8cf2f62c, 0xbc9b, 0x4821, {0x80, 0x8d, 0xec, 0x9e, 0xc4, 0x21, 0xa1, 0xa0} }
-
-typedef struct {
-  EFI_GUID     PartitionTypeGUID;
-  EFI_GUID     UniquePartitionGUID;
-  EFI_LBA      StartingLBA;
-  EFI_LBA      EndingLBA;
-  UINT64       Attributes;
-  CHAR16       PartitionName[36];
-} __attribute__((packed)) EFI_PARTITION_ENTRY;
-
-#define EFI_PARTITION_INFO_PROTOCOL_REVISION 0x0001000
-#define PARTITION_TYPE_OTHER 0x00
-#define PARTITION_TYPE_MBR 0x01
-#define PARTITION_TYPE_GPT 0x02
-
-typedef struct {
-
-  UINT32         Revision;
-  UINT32         Type;
-  UINT8          System;
-  UINT8          Reserved[7];
-  union {
-   MBR_PARTITION_RECORD Mbr;
-   EFI_PARTITION_ENTRY Gpt;
-  } Info;
-} __attribute__((packed)) EFI_PARTITION_INFO_PROTOCOL;
+#include <protocol/partition_info.h>
+#include <protocol/dpp.h>
 
 /**
  * locate_gpt_partition() - Get a handle to a partition with specific GPT name.
@@ -49,9 +24,9 @@ static EFI_STATUS locate_gpt_partition(CHAR16 *name, EFI_HANDLE *partition_handl
 	UINTN disk_count;
 	UINTN i;
 
-	status = LibLocateHandle(ByProtocol, &gEfiDiskIoProtocolGuid, NULL, &disk_count, &disk_handles);
-	if (EFI_ERROR(status))
-		return status;
+	disk_handles = arena_locate_handles(&gEfiDiskIoProtocolGuid, &disk_count);
+	if (!disk_handles)
+		return EFI_NOT_FOUND;
 
 	for (i = 0; i < disk_count; ++i) {
 		EFI_PARTITION_INFO_PROTOCOL *partition;
@@ -64,12 +39,10 @@ static EFI_STATUS locate_gpt_partition(CHAR16 *name, EFI_HANDLE *partition_handl
 
 		if (!StrCmp(name, partition->Info.Gpt.PartitionName)) {
 			*partition_handle = disk_handles[i];
-			FreePool(disk_handles);
 			return EFI_SUCCESS;
 		}
 	}
 
-	FreePool(disk_handles);
 	return EFI_NOT_FOUND;
 }
 
@@ -86,9 +59,9 @@ static EFI_STATUS locate_partition_by_magic(const UINT8 *magic, UINTN len, EFI_H
 
 	ASSERT(sizeof(tmp) >= len);
 
-	status = LibLocateHandle(ByProtocol, &gEfiDiskIoProtocolGuid, NULL, &disk_count, &disk_handles);
-	if (EFI_ERROR(status))
-		return status;
+	disk_handles = arena_locate_handles(&gEfiDiskIoProtocolGuid, &disk_count);
+	if (!disk_handles)
+		return EFI_NOT_FOUND;
 
 	for (i = 0; i < disk_count; ++i) {
 		EFI_BLOCK_IO_PROTOCOL *block_io;
@@ -108,12 +81,10 @@ static EFI_STATUS locate_partition_by_magic(const UINT8 *magic, UINTN len, EFI_H
 
 		if (!memcmp(magic, tmp, len)) {
 			*partition_handle = disk_handles[i];
-			FreePool(disk_handles);
 			return EFI_SUCCESS;
 		}
 	}
 
-	FreePool(disk_handles);
 	return EFI_NOT_FOUND;
 }
 
@@ -155,30 +126,79 @@ struct rwfs_blob {
 
 
 /**
- * qcom_dpp_read_file() - Read file data from DPP.
- * This allocates a pool with file data that should be freed.
+ * locate_dpp() - Locate DPP partition on qcom devices.
  */
-static EFI_STATUS qcom_dpp_read_file(EFI_HANDLE dpp_partition, CHAR16 *file_name, UINT8 **buf_ret, UINTN *len_ret)
+static EFI_STATUS locate_dpp(EFI_HANDLE *partition_handle)
 {
 	EFI_STATUS status;
-	UINT8 *buf;
-	UINTN len;
-	EFI_BLOCK_IO_PROTOCOL *block_io;
+	EFI_HANDLE dpp_partition;
+
+	status = locate_gpt_partition(L"DPP", &dpp_partition);
+	if (EFI_ERROR(status) && status != EFI_NOT_FOUND)
+		return status;
+
+	if (status == EFI_NOT_FOUND) {
+		status = locate_partition_by_magic(dpp_magic, sizeof(dpp_magic), &dpp_partition);
+		if (EFI_ERROR(status))
+			return status;
+	}
+
+	*partition_handle = dpp_partition;
+	return EFI_SUCCESS;
+}
+
+/* Sanity limit, real partitions have about a dozen entries. */
+#define DPP_MAX_TABLE_SIZE	(64 * 1024)
+
+/*
+ * Directory of the DPP partition, read once and shared by the MAC fixup
+ * and DTBLOADER_DPP_PROTOCOL.
+ */
+static struct {
+	bool loaded;
+	EFI_HANDLE partition;
+	UINT32 media_id;
 	EFI_DISK_IO_PROTOCOL *disk_io;
+	UINTN count;
+	DTBLOADER_DPP_FILE_INFO *files;
+	UINT64 *offsets;
+	UINT8 **data;
+} dpp_dir;
+
+static void dpp_copy_name(CHAR16 *dst, const CHAR16 *src)
+{
+	UINTN i;
+
+	for (i = 0; i < DTBLOADER_DPP_NAME_LEN && src[i]; ++i)
+		dst[i] = src[i];
+	dst[i] = 0;
+}
+
+static EFI_STATUS __dpp_dir_load(void)
+{
+	EFI_STATUS status;
+	EFI_BLOCK_IO_PROTOCOL *block_io;
 	struct rwfs_header header;
 	struct rwfs_second second_hdr;
-	struct rwfs_blob   blob;
-	UINTN offt;
+	struct rwfs_blob *blobs;
+	UINTN i, count, max;
+	UINT8 *mem;
+
+	status = locate_dpp(&dpp_dir.partition);
+	if (EFI_ERROR(status))
+		return status;
 
-	status = uefi_call_wrapper(BS->HandleProtocol, 3, dpp_partition, &gEfiBlockIoProtocolGuid, (void*)&block_io);
+	status = uefi_call_wrapper(BS->HandleProtocol, 3, dpp_dir.partition, &gEfiBlockIoProtocolGuid, (void*)&block_io);
 	if (EFI_ERROR(status))
 		return status;
 
-	status = uefi_call_wrapper(BS->HandleProtocol, 3, dpp_partition, &gEfiDiskIoProtocolGuid, (void*)&disk_io);
+	status = uefi_call_wrapper(BS->HandleProtocol, 3, dpp_dir.partition, &gEfiDiskIoProtocolGuid, (void*)&dpp_dir.disk_io);
 	if (EFI_ERROR(status))
 		return status;
 
-	status = uefi_call_wrapper(disk_io->ReadDisk, 5, disk_io, block_io->Media->MediaId, 0, sizeof(header), &header);
+	dpp_dir.media_id = block_io->Media->MediaId;
+
+	status = uefi_call_wrapper(dpp_dir.disk_io->ReadDisk, 5, dpp_dir.disk_io, dpp_dir.media_id, 0, sizeof(header), &header);
 	if (EFI_ERROR(status))
 		return status;
 
@@ -186,59 +206,326 @@ static EFI_STATUS qcom_dpp_read_file(EFI_HANDLE dpp_partition, CHAR16 *file_name
 		return EFI_UNSUPPORTED;
 	}
 
-	status = uefi_call_wrapper(disk_io->ReadDisk, 5, disk_io, block_io->Media->MediaId, header.hdr2_offt, sizeof(second_hdr), &second_hdr);
+	status = uefi_call_wrapper(dpp_dir.disk_io->ReadDisk, 5, dpp_dir.disk_io, dpp_dir.media_id, header.hdr2_offt, sizeof(second_hdr), &second_hdr);
 	if (EFI_ERROR(status))
 		return status;
 
-	for (offt = 0; offt < second_hdr.table_size; offt += sizeof(blob)) {
-		status = uefi_call_wrapper(disk_io->ReadDisk, 5, disk_io, block_io->Media->MediaId, second_hdr.table_offt + offt, sizeof(blob), &blob);
-		if (EFI_ERROR(status))
-			return status;
+	if (second_hdr.table_size > DPP_MAX_TABLE_SIZE)
+		return EFI_UNSUPPORTED;
 
-		if (!blob.present)
-			break;
+	/* One read for the whole table instead of one per entry. */
+	max = second_hdr.table_size / sizeof(*blobs);
+	blobs = arena_alloc(max * sizeof(*blobs));
+	if (!blobs)
+		return EFI_OUT_OF_RESOURCES;
 
-		if (!StriCmp(file_name, blob.name)) {
-			len = blob.data_len;
-			buf = AllocatePool(len);
+	status = uefi_call_wrapper(dpp_dir.disk_io->ReadDisk, 5, dpp_dir.disk_io, dpp_dir.media_id, second_hdr.table_offt, max * sizeof(*blobs), blobs);
+	if (EFI_ERROR(status))
+		return status;
 
-			status = uefi_call_wrapper(disk_io->ReadDisk, 5, disk_io, block_io->Media->MediaId, second_hdr.data_start + blob.offt, len, buf);
-			if (EFI_ERROR(status))
-				return status;
+	for (count = 0; count < max && blobs[count].present; ++count)
+		;
 
-			Dbg(L"DPP: Found %s/%s with %d bytes.\n", blob.vendor, blob.name, blob.data_len);
-			*buf_ret = buf;
-			*len_ret = len;
+	/* Used by the protocol later on, so not from the arena. */
+	mem = AllocateZeroPool(count * (sizeof(*dpp_dir.offsets) + sizeof(*dpp_dir.data) + sizeof(*dpp_dir.files)) + 1);
+	if (!mem)
+		return EFI_OUT_OF_RESOURCES;
 
-			return EFI_SUCCESS;
+	dpp_dir.offsets = (UINT64 *)mem;
+	dpp_dir.data = (UINT8 **)(dpp_dir.offsets + count);
+	dpp_dir.files = (DTBLOADER_DPP_FILE_INFO *)(dpp_dir.data + count);
+
+	for (i = 0; i < count; ++i) {
+		dpp_copy_name(dpp_dir.files[i].Name, blobs[i].name);
+		dpp_copy_name(dpp_dir.files[i].Vendor, blobs[i].vendor);
+		dpp_dir.files[i].Size = blobs[i].data_len;
+		dpp_dir.offsets[i] = second_hdr.data_start + blobs[i].offt;
+
+		Dbg(L"DPP: Found %s/%s with %d bytes.\n", dpp_dir.files[i].Vendor,
+		    dpp_dir.files[i].Name, dpp_dir.files[i].Size);
+	}
+
+	dpp_dir.count = count;
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * dpp_dir_load() - Find the DPP partition and read its directory, once.
+ *
+ * Failures aren't remembered, so a later caller (i.e. the fixup protocol
+ * after the prefetch hit a transient error) gets to try again.
+ */
+static EFI_STATUS dpp_dir_load(void)
+{
+	EFI_STATUS status;
+
+	if (dpp_dir.loaded)
+		return EFI_SUCCESS;
+
+	status = __dpp_dir_load();
+	if (EFI_ERROR(status))
+		return status;
+
+	dpp_dir.loaded = true;
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * dpp_dir_find() - Find a file in the DPP directory.
+ *
+ * Returns: Index of the file or -1 if there is none.
+ */
+static int dpp_dir_find(CHAR16 *file_name)
+{
+	UINTN i;
+
+	for (i = 0; i < dpp_dir.count; ++i)
+		if (!StriCmp(file_name, dpp_dir.files[i].Name))
+			return i;
+
+	return -1;
+}
+
+/**
+ * struct dpp_read - File read from DPP, possibly still in flight.
+ * @buf:    File data, provisioning files are only a few bytes.
+ * @file:   Index of the file in dpp_dir.
+ * @len:    Length of the data.
+ * @token:  Token of the async read, @token.Event is NULL once it's done.
+ * @status: Result of the read.
+ */
+struct dpp_read {
+	UINT8 buf[16];
+	int file;
+	UINTN len;
+	EFI_DISK_IO2_TOKEN token;
+	EFI_STATUS status;
+};
+
+/**
+ * qcom_dpp_read_start() - Start reading a file from DPP.
+ *
+ * The read is done with DiskIo2 in the background when the firmware
+ * supports it, use qcom_dpp_read_wait() to get the result.
+ */
+static EFI_STATUS qcom_dpp_read_start(CHAR16 *file_name, struct dpp_read *read)
+{
+	EFI_GUID disk_io2_guid = EFI_DISK_IO2_PROTOCOL_GUID;
+	EFI_DISK_IO2_PROTOCOL *disk_io2;
+	EFI_STATUS status;
+	UINT64 offset;
+	int file;
+
+	file = dpp_dir_find(file_name);
+	if (file < 0)
+		return EFI_NOT_FOUND;
+
+	offset = dpp_dir.offsets[file];
+	read->file = file;
+	read->len = dpp_dir.files[file].Size;
+
+	/* Read into the cache itself, it has to outlive the arena. */
+	if (read->len > sizeof(read->buf))
+		return EFI_UNSUPPORTED;
+
+	read->token.Event = NULL;
+
+	status = EFI_UNSUPPORTED;
+	if (CanWait())
+		status = uefi_call_wrapper(BS->HandleProtocol, 3, dpp_dir.partition, &disk_io2_guid, (void*)&disk_io2);
+	if (!EFI_ERROR(status)) {
+		status = uefi_call_wrapper(BS->CreateEvent, 5, 0, TPL_CALLBACK, NULL, NULL, &read->token.Event);
+		if (!EFI_ERROR(status)) {
+			status = uefi_call_wrapper(disk_io2->ReadDiskEx, 6, disk_io2, dpp_dir.media_id,
+						   offset, &read->token, read->len, read->buf);
+			if (!EFI_ERROR(status))
+				return EFI_SUCCESS;
+
+			uefi_call_wrapper(BS->CloseEvent, 1, read->token.Event);
+			read->token.Event = NULL;
 		}
 	}
 
-	return EFI_NOT_FOUND;
+	read->status = uefi_call_wrapper(dpp_dir.disk_io->ReadDisk, 5, dpp_dir.disk_io, dpp_dir.media_id,
+					 offset, read->len, read->buf);
+
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS qcom_dpp_read_wait(struct dpp_read *read)
+{
+	if (read->token.Event) {
+		WaitEvent(read->token.Event);
+		uefi_call_wrapper(BS->CloseEvent, 1, read->token.Event);
+		read->token.Event = NULL;
+		read->status = read->token.TransactionStatus;
+	}
+
+	return read->status;
 }
 
+/*
+ * Provisioning data is read once and kept around, so it can be prefetched
+ * while the DTB is loading and reused by the fixup protocol later on.
+ */
+static struct {
+	bool started;
+	struct dpp_read wlan;
+	struct dpp_read bt;
+} dpp_cache;
+
 /**
- * locate_dpp() - Locate DPP partition on qcom devices.
+ * dpp_cache_reset() - Drop the cached provisioning data.
+ *
+ * Reads that are still in flight are waited for first, since they write
+ * into the cache. The next qcom_dpp_prefetch() starts over.
  */
-static EFI_STATUS locate_dpp(EFI_HANDLE *partition_handle)
+static void dpp_cache_reset(void)
+{
+	qcom_dpp_read_wait(&dpp_cache.wlan);
+	qcom_dpp_read_wait(&dpp_cache.bt);
+
+	ZeroMem(&dpp_cache, sizeof(dpp_cache));
+}
+
+/**
+ * dpp_cache_copy() - Get a file from the provisioning data cache.
+ *
+ * Returns: EFI_NOT_FOUND if the file isn't cached, EFI_NOT_READY if it's
+ * still being read and can't be waited for here.
+ */
+static EFI_STATUS dpp_cache_copy(int file, UINT8 *data, UINTN len)
 {
+	struct dpp_read *reads[] = { &dpp_cache.wlan, &dpp_cache.bt };
 	EFI_STATUS status;
-	EFI_HANDLE dpp_partition;
+	UINTN i;
+
+	if (!dpp_cache.started)
+		return EFI_NOT_FOUND;
+
+	for (i = 0; i < ARRAY_SIZE(reads); ++i) {
+		if (reads[i]->file != file || reads[i]->len != len)
+			continue;
+
+		if (reads[i]->token.Event && !CanWait())
+			return EFI_NOT_READY;
+
+		status = qcom_dpp_read_wait(reads[i]);
+		if (!EFI_ERROR(status))
+			CopyMem(data, reads[i]->buf, len);
 
-	status = locate_gpt_partition(L"DPP", &dpp_partition);
-	if (EFI_ERROR(status) && status != EFI_NOT_FOUND)
 		return status;
+	}
 
-	if (status == EFI_NOT_FOUND) {
-		status = locate_partition_by_magic(dpp_magic, sizeof(dpp_magic), &dpp_partition);
+	return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI dpp_protocol_list(DTBLOADER_DPP_PROTOCOL *this, UINTN *count,
+					   DTBLOADER_DPP_FILE_INFO **files)
+{
+	if (!count || !files)
+		return EFI_INVALID_PARAMETER;
+
+	*count = dpp_dir.count;
+	*files = dpp_dir.files;
+
+	return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI dpp_protocol_read(DTBLOADER_DPP_PROTOCOL *this, CHAR16 *name,
+					   UINTN *size, VOID *buf)
+{
+	EFI_STATUS status;
+	UINT8 *data;
+	UINTN len;
+	int file;
+
+	if (!name || !size)
+		return EFI_INVALID_PARAMETER;
+
+	file = dpp_dir_find(name);
+	if (file < 0)
+		return EFI_NOT_FOUND;
+
+	len = dpp_dir.files[file].Size;
+	if (*size < len) {
+		*size = len;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+
+	if (!buf)
+		return EFI_INVALID_PARAMETER;
+
+	if (!dpp_dir.data[file]) {
+		data = AllocatePool(len + 1);
+		if (!data)
+			return EFI_OUT_OF_RESOURCES;
+
+		/* WLAN/BT.PROVISION are usually in memory already. */
+		status = dpp_cache_copy(file, data, len);
 		if (EFI_ERROR(status))
+			status = uefi_call_wrapper(dpp_dir.disk_io->ReadDisk, 5, dpp_dir.disk_io, dpp_dir.media_id,
+						   dpp_dir.offsets[file], len, data);
+		if (EFI_ERROR(status)) {
+			FreePool(data);
 			return status;
+		}
+
+		dpp_dir.data[file] = data;
 	}
 
-	*partition_handle = dpp_partition;
+	CopyMem(buf, dpp_dir.data[file], len);
+	*size = len;
+
 	return EFI_SUCCESS;
 }
 
+static DTBLOADER_DPP_PROTOCOL dpp_protocol = {
+	.Revision = DTBLOADER_DPP_PROTOCOL_REVISION,
+	.List = dpp_protocol_list,
+	.Read = dpp_protocol_read,
+};
+
+static EFI_HANDLE dpp_protocol_handle;
+
+/**
+ * qcom_dpp_publish() - Install DTBLOADER_DPP_PROTOCOL if the device uses DPP.
+ * @dev:    This device.
+ *
+ * Returns: EFI_UNSUPPORTED if the device doesn't read DPP.
+ */
+EFI_STATUS qcom_dpp_publish(struct device *dev)
+{
+	EFI_GUID guid = DTBLOADER_DPP_PROTOCOL_GUID;
+	EFI_STATUS status;
+
+	if (dev->prefetch != qcom_dpp_prefetch)
+		return EFI_UNSUPPORTED;
+
+	status = dpp_dir_load();
+	if (EFI_ERROR(status))
+		return status;
+
+	return uefi_call_wrapper(BS->InstallProtocolInterface, 4, &dpp_protocol_handle, &guid,
+				 EFI_NATIVE_INTERFACE, &dpp_protocol);
+}
+
+/**
+ * qcom_dpp_unpublish() - Uninstall DTBLOADER_DPP_PROTOCOL if it's installed.
+ */
+void qcom_dpp_unpublish(void)
+{
+	EFI_GUID guid = DTBLOADER_DPP_PROTOCOL_GUID;
+
+	if (!dpp_protocol_handle)
+		return;
+
+	uefi_call_wrapper(BS->UninstallProtocolInterface, 3, dpp_protocol_handle, &guid, &dpp_protocol);
+	dpp_protocol_handle = NULL;
+}
+
 struct wlan_provision {
 	UINT8 unk[3];
 	UINT8 mac[6];
@@ -249,6 +536,38 @@ struct bt_provision {
 	UINT8 mac[6];
 } __attribute__((packed));
 
+/**
+ * qcom_dpp_prefetch() - Start reading wifi/bt provisioning data from DPP.
+ * @dev:    This device.
+ *
+ * Only a successful start is remembered, on failure the next call (i.e.
+ * from the fixup protocol) tries again.
+ *
+ * Returns: Status of locating the data.
+ */
+EFI_STATUS qcom_dpp_prefetch(struct device *dev)
+{
+	EFI_STATUS status;
+
+	if (dpp_cache.started)
+		return EFI_SUCCESS;
+
+	status = dpp_dir_load();
+	if (!EFI_ERROR(status))
+		status = qcom_dpp_read_start(L"WLAN.PROVISION", &dpp_cache.wlan);
+	if (!EFI_ERROR(status))
+		status = qcom_dpp_read_start(L"BT.PROVISION", &dpp_cache.bt);
+
+	if (EFI_ERROR(status)) {
+		dpp_cache_reset();
+		return status;
+	}
+
+	dpp_cache.started = true;
+
+	return EFI_SUCCESS;
+}
+
 /**
  * qcom_dt_set_dpp_mac() - Set wifif/bt MAC for this device.
  * @dev:    This device.
@@ -260,11 +579,8 @@ struct bt_provision {
 EFI_STATUS qcom_dt_set_dpp_mac(struct device *dev, void *dtb)
 {
 	EFI_STATUS status;
-	EFI_HANDLE dpp_partition;
 	struct wlan_provision *wlan_file;
-	UINTN wlan_file_len;
 	struct bt_provision *bt_file;
-	UINTN bt_file_len;
 	UINT8 bd_addr[6];
 
 	const char * const mac_compatibles[] = {
@@ -280,27 +596,26 @@ EFI_STATUS qcom_dt_set_dpp_mac(struct device *dev, void *dtb)
 		"qcom,wcn7850-bt",
 	};
 
-	status = locate_dpp(&dpp_partition);
-	if (EFI_ERROR(status))
-		return status;
-
-	status = qcom_dpp_read_file(dpp_partition, L"WLAN.PROVISION", (UINT8**)&wlan_file, &wlan_file_len);
+	status = qcom_dpp_prefetch(dev);
 	if (EFI_ERROR(status))
 		return status;
 
-	status = qcom_dpp_read_file(dpp_partition, L"BT.PROVISION", (UINT8**)&bt_file, &bt_file_len);
+	status = qcom_dpp_read_wait(&dpp_cache.wlan);
+	if (!EFI_ERROR(status))
+		status = qcom_dpp_read_wait(&dpp_cache.bt);
 	if (EFI_ERROR(status)) {
-		FreePool(wlan_file);
+		dpp_cache_reset();
 		return status;
 	}
 
-	if (wlan_file_len != sizeof(struct wlan_provision) || bt_file_len != sizeof(struct bt_provision)) {
+	if (dpp_cache.wlan.len != sizeof(struct wlan_provision) || dpp_cache.bt.len != sizeof(struct bt_provision)) {
 		Print(L"DPP mac format is not supported.");
-		FreePool(wlan_file);
-		FreePool(bt_file);
 		return EFI_UNSUPPORTED;
 	}
 
+	wlan_file = (struct wlan_provision *)dpp_cache.wlan.buf;
+	bt_file = (struct bt_provision *)dpp_cache.bt.buf;
+
 	/*
 	 * BD address is encoded in little endian format (reversed),
 	 * with least significant bit flipped.
@@ -327,7 +642,5 @@ EFI_STATUS qcom_dt_set_dpp_mac(struct device *dev, void *dtb)
 	if (EFI_ERROR(status))
 		return status;
 
-	FreePool(wlan_file);
-	FreePool(bt_file);
 	return EFI_SUCCESS;
 }
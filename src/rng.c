@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Entropy for the kernel.
+ *
+ * Without a seed in the DT the kernel may wait for a long time until its
+ * CRNG is ready on these devices. The firmware RNG is slow to query, so
+ * it's read only once per boot into a pool, and every Fixup() call gets
+ * its own seed derived from that pool. A seed stored in a variable is
+ * mixed in and replaced on every boot, which covers firmware without
+ * EFI_RNG_PROTOCOL after the first boot with it.
+ *
+ * The stored seed is only useful while nobody else can read it, so it's
+ * kept without EFI_VARIABLE_RUNTIME_ACCESS (efivarfs files are readable
+ * by everyone) and isn't trusted as the only source of entropy if it was
+ * ever exposed or can't be replaced.
+ */
+
+#include <stdbool.h>
+#include <efi.h>
+#include <efilib.h>
+#include <libfdt.h>
+#include <sha1.h>
+
+#include <util.h>
+#include <rng.h>
+
+#include <protocol/rng.h>
+
+#define RNG_VARIABLE		L"DtbloaderRngSeed"
+#define RNG_FIRMWARE_BYTES	32
+#define RNG_VARIABLE_ATTRS	(EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS)
+
+static struct {
+	bool ready;
+	EFI_STATUS status;
+	SHA1_CTX pool;
+	UINT64 counter;
+} rng;
+
+/**
+ * rng_expand() - Produce @len bytes out of the current state of @ctx.
+ * @ctx:    Hash over the input material.
+ * @label:  Distinguishes different outputs of the same input.
+ */
+static void rng_expand(SHA1_CTX *ctx, UINT64 label, UINT8 *buf, UINTN len)
+{
+	UINT8 block[20];
+	SHA1_CTX tmp;
+	UINT32 i, n;
+
+	for (i = 0; len; ++i) {
+		tmp = *ctx;
+		SHA1Update(&tmp, (void *)&label, sizeof(label));
+		SHA1Update(&tmp, (void *)&i, sizeof(i));
+		SHA1Final(block, &tmp);
+
+		n = len < sizeof(block) ? len : sizeof(block);
+		CopyMem(buf, block, n);
+		buf += n;
+		len -= n;
+	}
+
+	ZeroMem(block, sizeof(block));
+}
+
+/**
+ * rng_store_seed() - Replace the stored seed, keeping it private to boot services.
+ * @exposed:  The current variable has other attributes and has to go first.
+ */
+static EFI_STATUS rng_store_seed(UINT8 *seed, UINTN size, bool exposed)
+{
+	EFI_GUID var_guid = DTBLOADER_VARIABLE_GUID;
+	EFI_STATUS status;
+
+	/* SetVariable() refuses to change the attributes of an existing variable. */
+	if (exposed) {
+		status = uefi_call_wrapper(RT->SetVariable, 5, RNG_VARIABLE, &var_guid,
+					   0, 0, NULL);
+		if (EFI_ERROR(status))
+			return status;
+	}
+
+	return uefi_call_wrapper(RT->SetVariable, 5, RNG_VARIABLE, &var_guid,
+				 RNG_VARIABLE_ATTRS, size, seed);
+}
+
+static EFI_STATUS rng_init(void)
+{
+	EFI_GUID rng_guid = EFI_RNG_PROTOCOL_GUID;
+	EFI_GUID var_guid = DTBLOADER_VARIABLE_GUID;
+	UINT8 fw[RNG_FIRMWARE_BYTES], seed[RNG_SEED_SIZE], next[RNG_SEED_SIZE];
+	bool have_fw = false, have_seed = false, exposed = false;
+	UINTN seed_size = sizeof(seed);
+	EFI_RNG_PROTOCOL *fw_rng;
+	EFI_STATUS status;
+	UINT32 attrs = 0;
+	UINT64 count;
+
+	SHA1Init(&rng.pool);
+
+	status = uefi_call_wrapper(BS->LocateProtocol, 3, &rng_guid, NULL, (void **)&fw_rng);
+	if (!EFI_ERROR(status))
+		status = uefi_call_wrapper(fw_rng->GetRNG, 3, fw_rng, NULL, sizeof(fw), fw);
+	if (!EFI_ERROR(status)) {
+		SHA1Update(&rng.pool, fw, sizeof(fw));
+		have_fw = true;
+	} else {
+		Dbg(L"RNG: No firmware RNG: %r\n", status);
+	}
+
+	status = uefi_call_wrapper(RT->GetVariable, 5, RNG_VARIABLE, &var_guid,
+				   &attrs, &seed_size, seed);
+	if (!EFI_ERROR(status) || status == EFI_BUFFER_TOO_SMALL)
+		exposed = attrs != RNG_VARIABLE_ATTRS;
+
+	if (!EFI_ERROR(status)) {
+		/* Still mixed in, it can't hurt, but it's no secret anymore. */
+		SHA1Update(&rng.pool, seed, seed_size);
+		have_seed = !exposed;
+		if (exposed)
+			Dbg(L"RNG: Stored seed was readable at runtime, not trusting it\n");
+	}
+
+	if (!have_fw && !have_seed)
+		return EFI_NOT_FOUND;
+
+	/* Not entropy, but makes sure we never reuse a stored seed as is. */
+	uefi_call_wrapper(BS->GetNextMonotonicCount, 1, &count);
+	SHA1Update(&rng.pool, (void *)&count, sizeof(count));
+
+	/* The label of the next seed is never used for the kernel. */
+	rng_expand(&rng.pool, 0, next, sizeof(next));
+	status = rng_store_seed(next, sizeof(next), exposed);
+
+	ZeroMem(fw, sizeof(fw));
+	ZeroMem(seed, sizeof(seed));
+	ZeroMem(next, sizeof(next));
+
+	if (EFI_ERROR(status)) {
+		Dbg(L"RNG: Failed to store the next seed: %r\n", status);
+
+		/* The next boot would start from the very same seed. */
+		if (!have_fw)
+			return EFI_ACCESS_DENIED;
+	}
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * rng_get_bytes() - Get random bytes, distinct for every call.
+ *
+ * Returns: EFI_NOT_FOUND if there is no source of entropy at all.
+ */
+EFI_STATUS rng_get_bytes(UINT8 *buf, UINTN len)
+{
+	if (!rng.ready) {
+		rng.status = rng_init();
+		rng.ready = true;
+	}
+
+	if (EFI_ERROR(rng.status))
+		return rng.status;
+
+	rng_expand(&rng.pool, ++rng.counter, buf, len);
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * rng_dt_fixup() - Add /chosen/rng-seed, and kaslr-seed if enabled.
+ * @dtb:    FDT to fixup.
+ *
+ * Seeds that are already there, i.e. set by the bootloader, are kept.
+ */
+EFI_STATUS rng_dt_fixup(void *dtb)
+{
+	UINT8 seed[RNG_SEED_SIZE];
+	EFI_STATUS status;
+	int node, ret;
+
+	node = fdt_path_offset(dtb, "/chosen");
+	if (node == -FDT_ERR_NOTFOUND)
+		node = fdt_add_subnode(dtb, 0, "chosen");
+	if (node < 0)
+		return EFI_INVALID_PARAMETER;
+
+	if (!fdt_getprop(dtb, node, "rng-seed", NULL)) {
+		status = rng_get_bytes(seed, sizeof(seed));
+		if (EFI_ERROR(status))
+			return status;
+
+		ret = fdt_setprop(dtb, node, "rng-seed", seed, sizeof(seed));
+		if (ret < 0)
+			return EFI_INVALID_PARAMETER;
+	}
+
+#ifdef KASLR_SEED
+	if (!fdt_getprop(dtb, node, "kaslr-seed", NULL)) {
+		status = rng_get_bytes(seed, sizeof(UINT64));
+		if (EFI_ERROR(status))
+			return status;
+
+		ret = fdt_setprop(dtb, node, "kaslr-seed", seed, sizeof(UINT64));
+		if (ret < 0)
+			return EFI_INVALID_PARAMETER;
+	}
+#endif
+
+	ZeroMem(seed, sizeof(seed));
+
+	return EFI_SUCCESS;
+}
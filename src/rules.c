@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Declarative variant rules.
+ *
+ * Devices sharing CHIDs are told apart by struct device.rules instead of
+ * a bespoke extra_match callback. Once the CHIDs of the board are known,
+ * the rules of every device listing one of them are collected into one
+ * set, with identical predicates merged, and the whole set is evaluated in
+ * one go. Devices for other boards never get their rules evaluated, so
+ * i.e. an ACPI region they name isn't read on unrelated machines. The
+ * SMBIOS-derived facts (i.e. the total memory size) are computed once.
+ * Matching a device is then only a lookup of cached results, so adding
+ * variants doesn't add probing.
+ *
+ * Rules that aren't in the set (too many of them, or a device built at
+ * runtime) are still evaluated, just not cached.
+ */
+
+#include <stdbool.h>
+#include <efi.h>
+#include <efilib.h>
+
+#include <util.h>
+#include <device.h>
+#include <rules.h>
+#include <smbios.h>
+#include <acpi.h>
+
+#define RULES_MAX		64
+
+#define SMBIOS_TYPE11_COUNT	0x04
+#define SMBIOS_TYPE17_SIZE	0x0c
+#define SMBIOS_TYPE17_EXT_SIZE	0x1c
+
+/**
+ * struct rule_entry - Evaluated rule.
+ * @rule:    First rule with this predicate.
+ * @result:  Whether it passed.
+ */
+struct rule_entry {
+	const struct match_rule *rule;
+	bool result;
+};
+
+static struct {
+	struct rule_entry entries[RULES_MAX];
+	UINTN count;
+	bool have_memory;
+	UINT64 memory_mb;
+} rules;
+
+static bool str_equal(const char *a, const char *b)
+{
+	if (!a || !b)
+		return a == b;
+
+	return !strcmpa((CHAR8 *)a, (CHAR8 *)b);
+}
+
+static bool str_contains(const CHAR8 *str, const char *sub)
+{
+	UINTN len = strlena((CHAR8 *)sub);
+
+	for (; *str; ++str)
+		if (!strncmpa((CHAR8 *)str, (CHAR8 *)sub, len))
+			return true;
+
+	return !len;
+}
+
+static bool rule_same(const struct match_rule *a, const struct match_rule *b)
+{
+	return a->kind == b->kind && a->type == b->type && a->offset == b->offset &&
+	       a->min == b->min && a->max == b->max && str_equal(a->str, b->str);
+}
+
+/**
+ * memory_size() - Sum the sizes of all type 17 memory devices, once.
+ *
+ * Returns: Installed memory in MiB.
+ */
+static UINT64 memory_size(void)
+{
+	SMBIOS_HEADER *hdr;
+	UINT64 total = 0;
+	UINT32 ext;
+	UINT16 size;
+	UINTN i;
+
+	if (rules.have_memory)
+		return rules.memory_mb;
+
+	for (i = 0; (hdr = smbios_find(SMBIOS_TYPE_MEMORY_DEVICE, i)); ++i) {
+		if (hdr->Length < SMBIOS_TYPE17_SIZE + sizeof(size))
+			continue;
+
+		CopyMem(&size, (UINT8 *)hdr + SMBIOS_TYPE17_SIZE, sizeof(size));
+
+		/* Not installed or unknown. */
+		if (!size || size == 0xffff)
+			continue;
+
+		if (size == 0x7fff && hdr->Length >= SMBIOS_TYPE17_EXT_SIZE + sizeof(ext)) {
+			CopyMem(&ext, (UINT8 *)hdr + SMBIOS_TYPE17_EXT_SIZE, sizeof(ext));
+			total += ext & 0x7fffffff;
+		} else if (size & 0x8000) {
+			total += (size & 0x7fff) / 1024;
+		} else {
+			total += size;
+		}
+	}
+
+	rules.have_memory = true;
+	rules.memory_mb = total;
+
+	return total;
+}
+
+static bool oem_string_present(const char *str)
+{
+	SMBIOS_HEADER *hdr;
+	CHAR8 *oem;
+	UINTN i;
+	UINT8 nr;
+
+	for (i = 0; (hdr = smbios_find(SMBIOS_TYPE_OEM_STRINGS, i)); ++i) {
+		if (hdr->Length <= SMBIOS_TYPE11_COUNT)
+			continue;
+
+		for (nr = 1; nr <= ((UINT8 *)hdr)[SMBIOS_TYPE11_COUNT]; ++nr) {
+			oem = smbios_string(hdr, nr);
+			if (oem && !strcmpa(oem, (CHAR8 *)str))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static bool acpi_region_in_range(const struct match_rule *rule)
+{
+	UINT64 base, len;
+	UINT8 val;
+
+	if (EFI_ERROR(acpi_find_opregion(rule->str, ACPI_REGION_SYSTEM_MEMORY, &base, &len)))
+		return false;
+
+	if (rule->offset >= len)
+		return false;
+
+	val = *(volatile UINT8 *)(UINTN)(base + rule->offset);
+
+	return val >= rule->min && val <= rule->max;
+}
+
+static bool rule_eval(const struct match_rule *rule)
+{
+	CHAR8 *str;
+
+	switch (rule->kind) {
+	case MATCH_RULE_SMBIOS_EQUALS:
+		str = smbios_get_string(rule->type, rule->offset);
+		return str && !strcmpa(str, (CHAR8 *)rule->str);
+	case MATCH_RULE_SMBIOS_CONTAINS:
+		str = smbios_get_string(rule->type, rule->offset);
+		return str && str_contains(str, rule->str);
+	case MATCH_RULE_OEM_STRING:
+		return oem_string_present(rule->str);
+	case MATCH_RULE_MEMORY_MB:
+		return memory_size() >= rule->min && memory_size() <= rule->max;
+	case MATCH_RULE_ACPI_REGION_U8:
+		return acpi_region_in_range(rule);
+	}
+
+	return false;
+}
+
+static struct rule_entry *rule_lookup(const struct match_rule *rule)
+{
+	UINTN i;
+
+	for (i = 0; i < rules.count; ++i)
+		if (rules.entries[i].rule == rule || rule_same(rules.entries[i].rule, rule))
+			return &rules.entries[i];
+
+	return NULL;
+}
+
+static bool device_has_chid(struct device *dev, EFI_GUID *hwids, UINTN count)
+{
+	UINTN i, j;
+
+	for (i = 0; dev->hwids[i].Data1; ++i)
+		for (j = 0; j < count; ++j)
+			if (!CompareGuid(&dev->hwids[i], &hwids[j]))
+				return true;
+
+	return false;
+}
+
+/**
+ * rules_compile() - Collect and evaluate the rules of this board's devices.
+ * @hwids:  CHIDs of the board.
+ * @count:  Number of CHIDs.
+ *
+ * Replaces the set from a previous call, so it can be called again for
+ * another board (i.e. by the host tools).
+ */
+void rules_compile(EFI_GUID *hwids, UINTN count)
+{
+	const struct match_rule *rule;
+	struct device **dev;
+	UINTN i;
+
+	rules.count = 0;
+
+	for_each_device(dev) {
+		if (!(*dev)->rules || !device_has_chid(*dev, hwids, count))
+			continue;
+
+		for (rule = (*dev)->rules; rule->kind; ++rule) {
+			if (rule_lookup(rule) || rules.count == RULES_MAX)
+				continue;
+
+			rules.entries[rules.count++].rule = rule;
+		}
+	}
+
+	for (i = 0; i < rules.count; ++i)
+		rules.entries[i].result = rule_eval(rules.entries[i].rule);
+
+	Dbg(L"Rules: %d predicates\n", rules.count);
+}
+
+/**
+ * rules_reset() - Forget the evaluated rules and what they were based on.
+ *
+ * Also drops the ACPI index. Has to be called along with smbios_reset()
+ * when the firmware tables are replaced.
+ */
+void rules_reset(void)
+{
+	rules.count = 0;
+	rules.have_memory = false;
+	rules.memory_mb = 0;
+
+	acpi_reset();
+}
+
+/**
+ * match_rules() - Check the variant rules of a device.
+ * @dev:  Device to check.
+ *
+ * Returns: true if all rules of the device pass or it has none.
+ */
+bool match_rules(struct device *dev)
+{
+	const struct match_rule *rule;
+	struct rule_entry *entry;
+
+	if (!dev->rules)
+		return true;
+
+	for (rule = dev->rules; rule->kind; ++rule) {
+		entry = rule_lookup(rule);
+		if (!(entry ? entry->result : rule_eval(rule)))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,246 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Multi-buffer SHA-1.
+ *
+ * Hashes up to four independent messages at once, one per lane. This is
+ * meant for many short messages, like the CHID payloads which are only a
+ * few blocks each, where the setup and buffering of one SHA1Update() call
+ * after another costs as much as the compression itself.
+ *
+ * The messages are padded block by block as they're consumed so nothing
+ * is copied up front. Lanes may have different lengths: once a lane runs
+ * out of blocks its state is kept while the others continue.
+ *
+ * On aarch64 the four lanes are the four words of NEON registers, other
+ * builds (i.e. the host tools on x86) run the same schedule one lane at a
+ * time.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
+
+#include <sha1x4.h>
+
+#define SHA1_BLOCK_SIZE		64
+
+static const UINT32 sha1_init[5] = {
+	0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+};
+
+static const UINT32 sha1_k[4] = {
+	0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6,
+};
+
+static inline UINT32 get_be32(const UINT8 *p)
+{
+	return (UINT32)p[0] << 24 | (UINT32)p[1] << 16 | (UINT32)p[2] << 8 | p[3];
+}
+
+static inline void put_be32(UINT8 *p, UINT32 v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static UINTN sha1_blocks(UINTN len)
+{
+	/* 0x80 terminator and 64-bit length have to fit after the data. */
+	return (len + 1 + 8 + SHA1_BLOCK_SIZE - 1) / SHA1_BLOCK_SIZE;
+}
+
+/**
+ * sha1_pad_block() - Get one padded block of a message.
+ * @msg:    The message.
+ * @len:    Size of the message.
+ * @block:  Index of the block.
+ * @out:    Resulting block.
+ */
+static void sha1_pad_block(const UINT8 *msg, UINTN len, UINTN block, UINT8 out[SHA1_BLOCK_SIZE])
+{
+	UINTN off = block * SHA1_BLOCK_SIZE, n = 0;
+	UINT64 bits = (UINT64)len * 8;
+	int i;
+
+	if (off < len) {
+		n = len - off < SHA1_BLOCK_SIZE ? len - off : SHA1_BLOCK_SIZE;
+		CopyMem(out, (UINT8 *)msg + off, n);
+	}
+
+	ZeroMem(out + n, SHA1_BLOCK_SIZE - n);
+
+	if (len >= off && len < off + SHA1_BLOCK_SIZE)
+		out[len - off] = 0x80;
+
+	if (block == sha1_blocks(len) - 1)
+		for (i = 0; i < 8; ++i)
+			out[SHA1_BLOCK_SIZE - 1 - i] = bits >> (i * 8);
+}
+
+#ifdef __aarch64__
+
+#define ROL(x, n)	vsriq_n_u32(vshlq_n_u32(x, n), x, 32 - (n))
+
+/**
+ * sha1x4_compress() - Run one block through all lanes.
+ * @state:   Lane-interleaved state, state[i][lane].
+ * @w:       Lane-interleaved message words, w[i][lane].
+ * @active:  Lanes to update, the rest keep their state.
+ */
+static void sha1x4_compress(UINT32 state[5][SHA1X4_LANES], UINT32 w[16][SHA1X4_LANES],
+			    const UINT32 active[SHA1X4_LANES])
+{
+	uint32x4_t a, b, c, d, e, f, t, W[16], s[5];
+	uint32x4_t mask = vld1q_u32(active);
+	int i;
+
+	for (i = 0; i < 5; ++i)
+		s[i] = vld1q_u32(state[i]);
+
+	for (i = 0; i < 16; ++i)
+		W[i] = vld1q_u32(w[i]);
+
+	a = s[0];
+	b = s[1];
+	c = s[2];
+	d = s[3];
+	e = s[4];
+
+	for (i = 0; i < 80; ++i) {
+		if (i >= 16) {
+			t = veorq_u32(veorq_u32(W[(i - 3) & 15], W[(i - 8) & 15]),
+				      veorq_u32(W[(i - 14) & 15], W[i & 15]));
+			W[i & 15] = ROL(t, 1);
+		}
+
+		if (i < 20)
+			f = vbslq_u32(b, c, d);
+		else if (i >= 40 && i < 60)
+			f = vorrq_u32(vandq_u32(b, c), vandq_u32(d, veorq_u32(b, c)));
+		else
+			f = veorq_u32(veorq_u32(b, c), d);
+
+		t = vaddq_u32(vaddq_u32(ROL(a, 5), f),
+			      vaddq_u32(vaddq_u32(e, vdupq_n_u32(sha1_k[i / 20])), W[i & 15]));
+		e = d;
+		d = c;
+		c = ROL(b, 30);
+		b = a;
+		a = t;
+	}
+
+	s[0] = vbslq_u32(mask, vaddq_u32(s[0], a), s[0]);
+	s[1] = vbslq_u32(mask, vaddq_u32(s[1], b), s[1]);
+	s[2] = vbslq_u32(mask, vaddq_u32(s[2], c), s[2]);
+	s[3] = vbslq_u32(mask, vaddq_u32(s[3], d), s[3]);
+	s[4] = vbslq_u32(mask, vaddq_u32(s[4], e), s[4]);
+
+	for (i = 0; i < 5; ++i)
+		vst1q_u32(state[i], s[i]);
+}
+
+#else
+
+#define ROL(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1x4_compress(UINT32 state[5][SHA1X4_LANES], UINT32 w[16][SHA1X4_LANES],
+			    const UINT32 active[SHA1X4_LANES])
+{
+	UINT32 a, b, c, d, e, f, t, W[16];
+	int i, lane;
+
+	for (lane = 0; lane < SHA1X4_LANES; ++lane) {
+		if (!active[lane])
+			continue;
+
+		for (i = 0; i < 16; ++i)
+			W[i] = w[i][lane];
+
+		a = state[0][lane];
+		b = state[1][lane];
+		c = state[2][lane];
+		d = state[3][lane];
+		e = state[4][lane];
+
+		for (i = 0; i < 80; ++i) {
+			if (i >= 16) {
+				t = W[(i - 3) & 15] ^ W[(i - 8) & 15] ^ W[(i - 14) & 15] ^ W[i & 15];
+				W[i & 15] = ROL(t, 1);
+			}
+
+			if (i < 20)
+				f = (b & c) | (~b & d);
+			else if (i >= 40 && i < 60)
+				f = (b & c) | (d & (b ^ c));
+			else
+				f = b ^ c ^ d;
+
+			t = ROL(a, 5) + f + e + sha1_k[i / 20] + W[i & 15];
+			e = d;
+			d = c;
+			c = ROL(b, 30);
+			b = a;
+			a = t;
+		}
+
+		state[0][lane] += a;
+		state[1][lane] += b;
+		state[2][lane] += c;
+		state[3][lane] += d;
+		state[4][lane] += e;
+	}
+}
+
+#endif
+
+/**
+ * sha1x4() - Hash up to four independent messages at once.
+ * @msg:     Messages, NULL for unused lanes.
+ * @len:     Message sizes.
+ * @digest:  Resulting hashes, left alone for unused lanes.
+ */
+void sha1x4(const UINT8 *const msg[SHA1X4_LANES], const UINTN len[SHA1X4_LANES],
+	    UINT8 digest[SHA1X4_LANES][SHA1_DIGEST_SIZE])
+{
+	UINT32 state[5][SHA1X4_LANES], w[16][SHA1X4_LANES] = { 0 }, active[SHA1X4_LANES];
+	UINTN blocks[SHA1X4_LANES], max = 0, block;
+	UINT8 buf[SHA1_BLOCK_SIZE];
+	int i, lane;
+
+	for (lane = 0; lane < SHA1X4_LANES; ++lane) {
+		blocks[lane] = msg[lane] ? sha1_blocks(len[lane]) : 0;
+		if (blocks[lane] > max)
+			max = blocks[lane];
+
+		for (i = 0; i < 5; ++i)
+			state[i][lane] = sha1_init[i];
+	}
+
+	for (block = 0; block < max; ++block) {
+		for (lane = 0; lane < SHA1X4_LANES; ++lane) {
+			active[lane] = block < blocks[lane] ? ~0U : 0;
+			if (!active[lane])
+				continue;
+
+			sha1_pad_block(msg[lane], len[lane], block, buf);
+			for (i = 0; i < 16; ++i)
+				w[i][lane] = get_be32(buf + i * 4);
+		}
+
+		/* Idle lanes are computed on stale words and then discarded. */
+		sha1x4_compress(state, w, active);
+	}
+
+	for (lane = 0; lane < SHA1X4_LANES; ++lane) {
+		if (!msg[lane])
+			continue;
+
+		for (i = 0; i < 5; ++i)
+			put_be32(digest[lane] + i * 4, state[i][lane]);
+	}
+}
@@ -0,0 +1,197 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/*
+ * Indexed SMBIOS table access.
+ *
+ * The table is walked at most once, and only as far as needed: every
+ * query continues the walk from where the last one stopped until the
+ * structure it asks for is found. Each visited structure is recorded
+ * along with the start of each of its strings, so later lookups of any
+ * type (i.e. 3, 11 or 17 from extra_match callbacks) never re-scan.
+ *
+ * The walk is bounded by the table size from the entry point, so a
+ * missing end-of-table structure can't make us run off.
+ */
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <util.h>
+#include <smbios.h>
+
+#define SMBIOS_MAX_STRUCTS	256
+#define SMBIOS_MAX_STRINGS	1024
+
+/**
+ * struct smbios_struct - Visited structure.
+ * @hdr:      Formatted area of the structure.
+ * @strings:  Index of the first string in smbios.strings.
+ * @count:    Number of strings in the string set.
+ */
+struct smbios_struct {
+	SMBIOS_HEADER *hdr;
+	UINT16 strings;
+	UINT8 count;
+};
+
+static struct {
+	bool init;
+	UINT8 *pos;
+	UINT8 *end;
+	struct smbios_struct structs[SMBIOS_MAX_STRUCTS];
+	UINTN struct_count;
+	CHAR8 *strings[SMBIOS_MAX_STRINGS];
+	UINTN string_count;
+} smbios;
+
+static void smbios_init(void)
+{
+	SMBIOS_STRUCTURE_TABLE *table = NULL;
+	SMBIOS3_STRUCTURE_TABLE *table3 = NULL;
+
+	smbios.init = true;
+
+	if (!EFI_ERROR(LibGetSystemConfigurationTable(&SMBIOSTableGuid, (VOID **)&table))) {
+		smbios.pos = (UINT8 *)(UINTN)table->TableAddress;
+		smbios.end = smbios.pos + table->TableLength;
+	} else if (!EFI_ERROR(LibGetSystemConfigurationTable(&SMBIOS3TableGuid, (VOID **)&table3))) {
+		smbios.pos = (UINT8 *)(UINTN)table3->TableAddress;
+		smbios.end = smbios.pos + table3->TableMaximumSize;
+	}
+}
+
+/**
+ * smbios_next() - Index one more structure.
+ *
+ * Returns: The new entry or NULL at the end of the table.
+ */
+static struct smbios_struct *smbios_next(void)
+{
+	struct smbios_struct *s;
+	SMBIOS_HEADER *hdr;
+	bool empty = true;
+	UINT8 *p;
+
+	if (!smbios.init)
+		smbios_init();
+
+	if (!smbios.pos || smbios.struct_count == SMBIOS_MAX_STRUCTS)
+		return NULL;
+
+	hdr = (SMBIOS_HEADER *)smbios.pos;
+	if (smbios.end - smbios.pos < sizeof(*hdr) || hdr->Length < sizeof(*hdr) ||
+	    smbios.end - smbios.pos < hdr->Length || hdr->Type == SMBIOS_TYPE_END_OF_TABLE) {
+		smbios.pos = NULL;
+		return NULL;
+	}
+
+	s = &smbios.structs[smbios.struct_count++];
+	s->hdr = hdr;
+	s->strings = smbios.string_count;
+	s->count = 0;
+
+	/* The string set ends with an empty string, or is just two NULs. */
+	p = smbios.pos + hdr->Length;
+	while (p < smbios.end && *p) {
+		empty = false;
+		if (smbios.string_count < SMBIOS_MAX_STRINGS && s->count < 255) {
+			smbios.strings[smbios.string_count++] = (CHAR8 *)p;
+			s->count++;
+		}
+
+		while (p < smbios.end && *p)
+			p++;
+		p++;
+	}
+
+	p += empty ? 2 : 1;
+
+	/* A string set running past the end is as good as no end marker. */
+	smbios.pos = p <= smbios.end ? p : NULL;
+
+	return s;
+}
+
+static struct smbios_struct *smbios_lookup(UINT8 type, UINTN instance)
+{
+	struct smbios_struct *s;
+	UINTN i;
+
+	for (i = 0; i < smbios.struct_count; ++i)
+		if (smbios.structs[i].hdr->Type == type && !instance--)
+			return &smbios.structs[i];
+
+	while ((s = smbios_next()))
+		if (s->hdr->Type == type && !instance--)
+			return s;
+
+	return NULL;
+}
+
+static CHAR8 *struct_string(struct smbios_struct *s, UINT8 nr)
+{
+	if (!nr || nr > s->count)
+		return NULL;
+
+	return smbios.strings[s->strings + nr - 1];
+}
+
+/**
+ * smbios_find() - Find a structure.
+ * @type:      SMBIOS structure type.
+ * @instance:  Which one of the structures of @type to get, starting at 0.
+ *
+ * Returns: The structure or NULL if there is no such structure.
+ */
+SMBIOS_HEADER *smbios_find(UINT8 type, UINTN instance)
+{
+	struct smbios_struct *s = smbios_lookup(type, instance);
+
+	return s ? s->hdr : NULL;
+}
+
+/**
+ * smbios_string() - Get a string of a structure.
+ * @hdr:  Structure returned by smbios_find().
+ * @nr:   String number, starting at 1.
+ *
+ * Returns: The string or NULL if it's not set.
+ */
+CHAR8 *smbios_string(SMBIOS_HEADER *hdr, UINT8 nr)
+{
+	UINTN i;
+
+	for (i = 0; i < smbios.struct_count; ++i)
+		if (smbios.structs[i].hdr == hdr)
+			return struct_string(&smbios.structs[i], nr);
+
+	return NULL;
+}
+
+/**
+ * smbios_get_string() - Get a string field of the first structure of a type.
+ * @type:    SMBIOS structure type.
+ * @offset:  Offset of the string number in the structure.
+ *
+ * Returns: The string or NULL if the structure, field or string is missing.
+ */
+CHAR8 *smbios_get_string(UINT8 type, UINTN offset)
+{
+	struct smbios_struct *s = smbios_lookup(type, 0);
+
+	if (!s || offset >= s->hdr->Length)
+		return NULL;
+
+	return struct_string(s, ((UINT8 *)s->hdr)[offset]);
+}
+
+/**
+ * smbios_reset() - Forget the index, i.e. after the table has been replaced.
+ */
+void smbios_reset(void)
+{
+	smbios.init = false;
+	smbios.pos = NULL;
+	smbios.struct_count = 0;
+	smbios.string_count = 0;
+}
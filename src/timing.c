@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <efi.h>
+#include <efilib.h>
+
+#include <timing.h>
+
+struct timing_stage timing_stages[TIMING_MAX_STAGES];
+int timing_count;
+
+/* Host builds provide their own clock. */
+#ifndef DTBLOADER_HOST
+UINT64 timer_ticks(void)
+{
+	UINT64 val;
+
+	asm volatile("isb; mrs %0, cntvct_el0" : "=r" (val) : : "memory");
+	return val;
+}
+
+UINT64 timer_freq(void)
+{
+	UINT64 val;
+
+	asm volatile("mrs %0, cntfrq_el0" : "=r" (val));
+	return val;
+}
+#endif
+
+UINT64 timer_us(UINT64 ticks)
+{
+	UINT64 freq = timer_freq();
+
+	if (!freq)
+		return 0;
+
+	return ticks / freq * 1000000 + (ticks % freq) * 1000000 / freq;
+}
+
+/**
+ * timing_begin() - Record the start of a stage.
+ * @name:  Name of the stage, must stay valid.
+ *
+ * Returns: Stage number to pass to timing_end() or -1 if the log is full.
+ */
+int timing_begin(const CHAR16 *name)
+{
+	UINT64 now = timer_ticks();
+
+	if (timing_count >= TIMING_MAX_STAGES)
+		return -1;
+
+	timing_stages[timing_count].name  = name;
+	timing_stages[timing_count].start = now;
+	timing_stages[timing_count].end   = 0;
+
+	return timing_count++;
+}
+
+void timing_end(int stage)
+{
+	if (stage < 0)
+		return;
+
+	timing_stages[stage].end = timer_ticks();
+}
+
+/**
+ * timing_report() - Print all recorded stages.
+ *
+ * Each line has the start of the stage relative to the first one
+ * and its duration. Stages may overlap. Only TIMING=1 builds print
+ * anything.
+ */
+void timing_report(void)
+{
+#ifdef DTBLOADER_TIMING
+	int i;
+
+	for (i = 0; i < timing_count; ++i) {
+		struct timing_stage *s = &timing_stages[i];
+
+		Print(L"Stage %s: +%ld us, %ld us\n", s->name,
+		      timer_us(s->start - timing_stages[0].start),
+		      s->end ? timer_us(s->end - s->start) : 0);
+	}
+#endif
+}
@@ -6,7 +6,9 @@
 #include <efilib.h>
 #include <sha1.h>
 
+#include <string.h>
 #include <util.h>
+#include <arena.h>
 
 EFI_FILE_HANDLE GetVolume(EFI_HANDLE image)
 {
@@ -49,13 +51,10 @@ EFI_FILE_HANDLE FileOpen(EFI_FILE_HANDLE Volume, CHAR16 *FileName)
 
 UINT64 FileSize(EFI_FILE_HANDLE FileHandle)
 {
-	UINT64 ret;
 	EFI_FILE_INFO       *FileInfo;         /* file information structure */
 	/* get the file's size */
-	FileInfo = LibFileInfo(FileHandle);
-	ret = FileInfo->FileSize;
-	FreePool(FileInfo);
-	return ret;
+	FileInfo = arena_file_info(FileHandle);
+	return FileInfo ? FileInfo->FileSize : 0;
 }
 
 UINT64 FileRead(EFI_FILE_HANDLE FileHandle, UINT8 *Buffer, UINT64 ReadSize)
@@ -74,7 +73,7 @@ EFI_STATUS AllocateZeroPages(UINT64 page_count, EFI_PHYSICAL_ADDRESS *addr)
 	EFI_STATUS status = uefi_call_wrapper(BS->AllocatePages, 4, AllocateAnyPages, EfiLoaderData, page_count, addr);
 
 	if (!EFI_ERROR(status))
-		ZeroMem(*(UINT8 **)addr, page_count * 4096);
+		memset(*(UINT8 **)addr, 0, page_count * 4096);
 
 	return status;
 }
@@ -84,6 +83,32 @@ void FreePages(EFI_PHYSICAL_ADDRESS addr, UINT64 page_count)
 	uefi_call_wrapper(BS->FreePages, 2, addr, page_count);
 }
 
+/**
+ * CanWait() - Check if we run at TPL_APPLICATION and may block on events.
+ *
+ * Above it (i.e. when called from an event notification function) the
+ * completions we'd wait for may need notifications that can't run until
+ * we return, so async work must not be started there at all.
+ */
+bool CanWait(void)
+{
+	EFI_TPL tpl = uefi_call_wrapper(BS->RaiseTPL, 1, TPL_HIGH_LEVEL);
+
+	uefi_call_wrapper(BS->RestoreTPL, 1, tpl);
+
+	return tpl == TPL_APPLICATION;
+}
+
+/**
+ * WaitEvent() - Wait for a single event, only valid if CanWait().
+ */
+EFI_STATUS WaitEvent(EFI_EVENT event)
+{
+	UINTN index;
+
+	return uefi_call_wrapper(BS->WaitForEvent, 3, 1, &event, &index);
+}
+
 CHAR16 *StrrChr(CHAR16 *str, CHAR16 ch)
 {
 	CHAR16 *last = ch ? 0 : str;
@@ -102,19 +127,38 @@ bool SecureBootEnabled(void)
 {
 	uint8_t *secureboot, *setupmode, ret = true;
 
-	secureboot = LibGetVariable(L"SecureBoot", &gEfiGlobalVariableGuid);
+	secureboot = arena_get_variable(L"SecureBoot", &gEfiGlobalVariableGuid, NULL);
 
 	if (!secureboot)
 		return false;
 
-	setupmode = LibGetVariable(L"SetupMode", &gEfiGlobalVariableGuid);
+	setupmode = arena_get_variable(L"SetupMode", &gEfiGlobalVariableGuid, NULL);
 
 	if (*secureboot == 0 || (setupmode && *setupmode == 1))
 		ret = false;
 
-	FreePool(secureboot);
-	if (setupmode)
-		FreePool(setupmode);
-
 	return ret;
 }
+
+/**
+ * ConfirmHashChange() - Ask the user to accept changed data and remember it.
+ * @var:     Variable the hash of the accepted data is stored in.
+ * @guid:    Vendor GUID of @var.
+ * @hash:    Hash of the new data.
+ * @prompt:  Message shown to the user.
+ */
+EFI_STATUS ConfirmHashChange(CHAR16 *var, EFI_GUID *guid, EFI_SHA1_HASH *hash, CHAR16 *prompt)
+{
+	EFI_INPUT_KEY key;
+
+	/* Nobody can confirm anything from a notification, keep the old data. */
+	if (!CanWait())
+		return EFI_ACCESS_DENIED;
+
+	Print(L"%es\n", prompt);
+
+	WaitEvent(ST->ConIn->WaitForKey);
+	uefi_call_wrapper(ST->ConIn->ReadKeyStroke, 2, ST->ConIn, &key);
+
+	return LibSetNVVariable(var, guid, sizeof(*hash), hash);
+}